@@ -26,6 +26,9 @@
 #include "Set.cpp"
 #include "Numerical.cpp"
 #include "Vector.cpp"
+#include "CSRGraph.cpp"
+#include "BasicBigraph.cpp"
+#include "BasicGroupBigraph.cpp"
 #include "BaseSpline.h"
 
 class FidoVectorTest : public ::testing::Test {
@@ -198,3 +201,244 @@ EXPECT_EQ(-15,(int)res[0]);
 EXPECT_EQ(8,(int)res[1]);
 EXPECT_EQ(2,(int)res[2]);
 }
+
+TEST(FidoNumericalTest, BatchMatchesScalar){
+  const int n = 9;
+  double x[n] = {-1100.0, -52.5, -3.0, -0.25, 0.0, 0.5, 7.0, 31.75, 1000.0};
+  double res[n];
+  Numerical::exp2Batch(x, res, n);
+  for(int i=0; i<n; i++){
+    EXPECT_EQ(::exp2(x[i]), res[i]);
+  }
+  double pos[n] = {1e-300, 1e-5, 0.125, 0.5, 1.0, 3.0, 1024.0, 1e10, 1e300};
+  Numerical::log2Batch(pos, res, n);
+  for(int i=0; i<n; i++){
+    EXPECT_EQ(::log2(pos[i]), res[i]);
+  }
+  // result may alias the input
+  double y[n];
+  for(int i=0; i<n; i++){
+    y[i] = x[i];
+  }
+  Numerical::exp2Batch(y, y, n);
+  for(int i=0; i<n; i++){
+    EXPECT_EQ(::exp2(x[i]), y[i]);
+  }
+}
+
+TEST(FidoNumericalTest, LogAddBatch){
+  const double ninf = -Numerical::inf();
+  const int n = 6;
+  double x[n] = {-2.0, ninf, 3.5, -40.0, ninf, 3.5};
+  double fold = x[0];
+  for(int i=1; i<n; i++){
+    fold = Numerical::logAdd(fold, x[i]);
+  }
+  EXPECT_NEAR(fold, Numerical::logAddBatch(x, n), 1e-12);
+  // a -inf term leaves the other term unchanged
+  EXPECT_EQ(-2.0, Numerical::logAdd(-2.0, ninf));
+  EXPECT_EQ(-2.0, Numerical::logAdd(ninf, -2.0));
+  EXPECT_EQ(ninf, Numerical::logAdd(ninf, ninf));
+  // the empty sum and a sum of zeros are both -inf
+  double allInf[3] = {ninf, ninf, ninf};
+  EXPECT_EQ(ninf, Numerical::logAddBatch(allInf, 3));
+  EXPECT_EQ(ninf, Numerical::logAddBatch(allInf, 0));
+  double one[1] = {ninf};
+  EXPECT_EQ(ninf, Numerical::logAddBatch(one, 1));
+  one[0] = -7.25;
+  EXPECT_EQ(-7.25, Numerical::logAddBatch(one, 1));
+  // longer than one block of the batched loop
+  const int m = 1000;
+  double y[m];
+  double yFold = ninf;
+  for(int i=0; i<m; i++){
+    y[i] = (i % 7 == 0) ? ninf : -0.01 * i;
+    yFold = Numerical::logAdd(yFold, y[i]);
+  }
+  EXPECT_NEAR(yFold, Numerical::logAddBatch(y, m), 1e-10);
+}
+
+class FidoGraphTest : public ::testing::Test {
+ protected:
+  virtual void SetUp() {
+    // peptide -> protein edges, with repeated edges and rows out of order
+    edges.clear();
+    edges.push_back(make_pair(0,2));
+    edges.push_back(make_pair(0,0));
+    edges.push_back(make_pair(0,2));
+    edges.push_back(make_pair(2,1));
+    edges.push_back(make_pair(0,0));
+    edges.push_back(make_pair(3,3));
+    edges.push_back(make_pair(2,1));
+    edges.push_back(make_pair(2,2));
+  }
+  virtual void TearDown() {}
+
+  vector<pair<int,int> > edges;
+};
+
+TEST_F(FidoGraphTest, CSRAdjacency){
+  CSRAdjacency empty;
+  EXPECT_EQ(0,empty.size());
+  EXPECT_EQ(0,empty.numberEdges());
+
+  CSRAdjacency adj(4,edges);
+  EXPECT_EQ(4,adj.size());
+  EXPECT_EQ(5,adj.numberEdges());
+  EXPECT_EQ(2,adj.degree(0));
+  EXPECT_EQ(0,adj.neighbor(0,0));
+  EXPECT_EQ(2,adj.neighbor(0,1));
+  EXPECT_EQ(0,adj.degree(1));
+  EXPECT_EQ(2,adj.degree(2));
+  EXPECT_EQ(1,adj.neighbor(2,0));
+  EXPECT_EQ(2,adj.neighbor(2,1));
+  EXPECT_EQ(1,adj.degree(3));
+  EXPECT_EQ(3,adj.neighbor(3,0));
+  Set row = adj.row(0);
+  EXPECT_EQ(2,row.size());
+  EXPECT_EQ(0,row[0]);
+  EXPECT_EQ(2,row[1]);
+  EXPECT_TRUE(adj.row(1).isEmpty());
+}
+
+TEST_F(FidoGraphTest, CSRAdjacencyTranspose){
+  CSRAdjacency adj(4,edges);
+  CSRAdjacency trans(4,edges,true);
+  EXPECT_EQ(4,trans.size());
+  EXPECT_EQ(adj.numberEdges(),trans.numberEdges());
+  EXPECT_EQ(1,trans.degree(0));
+  EXPECT_EQ(0,trans.neighbor(0,0));
+  EXPECT_EQ(1,trans.degree(1));
+  EXPECT_EQ(2,trans.neighbor(1,0));
+  EXPECT_EQ(2,trans.degree(2));
+  EXPECT_EQ(0,trans.neighbor(2,0));
+  EXPECT_EQ(2,trans.neighbor(2,1));
+  EXPECT_EQ(1,trans.degree(3));
+  EXPECT_EQ(3,trans.neighbor(3,0));
+  // every edge of the transpose is an edge of the original
+  for(int k=0; k<trans.size(); k++){
+    for(int j=0; j<trans.degree(k); j++){
+      EXPECT_NE(-1,adj.row(trans.neighbor(k,j)).find(k));
+    }
+  }
+}
+
+TEST_F(FidoGraphTest, UnionFind){
+  UnionFind uf(6);
+  for(int i=0; i<6; i++){
+    EXPECT_EQ(i,uf.find(i));
+  }
+  uf.unite(0,2);
+  uf.unite(4,5);
+  uf.unite(2,4);
+  uf.unite(5,0);
+  EXPECT_EQ(uf.find(0),uf.find(2));
+  EXPECT_EQ(uf.find(0),uf.find(4));
+  EXPECT_EQ(uf.find(0),uf.find(5));
+  EXPECT_NE(uf.find(0),uf.find(1));
+  EXPECT_NE(uf.find(0),uf.find(3));
+  EXPECT_NE(uf.find(1),uf.find(3));
+  EXPECT_EQ(1,uf.find(1));
+  EXPECT_EQ(3,uf.find(3));
+
+  // the connected components of the peptide-protein graph above, with the
+  // proteins numbered after the four peptides
+  UnionFind components(8);
+  for(size_t i=0; i<edges.size(); i++){
+    components.unite(edges[i].first,4+edges[i].second);
+  }
+  EXPECT_EQ(components.find(0),components.find(4));
+  EXPECT_EQ(components.find(0),components.find(2));
+  EXPECT_EQ(components.find(2),components.find(5));
+  EXPECT_EQ(components.find(3),components.find(7));
+  EXPECT_NE(components.find(0),components.find(3));
+  EXPECT_EQ(1,components.find(1));
+}
+
+class FidoGroupGraphTest : public ::testing::Test {
+ protected:
+  virtual void SetUp() {
+    // P1 and P2 share their PSMs and so do P5 and P6, which gives the
+    // groups {P1,P2} {P3} {P4} {P5,P6} {P7}
+    std::istringstream graph(
+      "e a\nr P1\nr P2\np 0.9\n"
+      "e b\nr P1\nr P2\nr P3\np 0.6\n"
+      "e c\nr P3\nr P4\np 0.3\n"
+      "e d\nr P4\np 0.75\n"
+      "e e\nr P5\nr P6\np 0.05\n"
+      "e f\nr P5\nr P6\nr P7\np 0.99\n");
+    bigraph.read(graph);
+  }
+  virtual void TearDown() {}
+
+  // the posterior of every group from the sum over all configurations of
+  // the group counters, without the Gray code sweep
+  Array<double> bruteForce(const BasicGroupBigraph & groupGraph, const Model & m) {
+    Array<Counter> n = groupGraph.getOriginalN();
+    const GraphLayer & psms = groupGraph.PSMsToProteins;
+    double prior = bigraph.getPeptidePrior();
+    double total = 0.0;
+    vector<double> weightedState(n.size(), 0.0);
+    for(Counter::start(n); Counter::inRange(n); Counter::advance(n)){
+      double term = 1.0;
+      for(int k=0; k<n.size(); k++){
+        term *= m.probabilityProteins(n[k].size,n[k].state);
+      }
+      for(int k=0; k<psms.size(); k++){
+        int active = 0;
+        for(int j=0; j<psms.associations[k].size(); j++){
+          active += n[ psms.associations[k][j] ].state;
+        }
+        double probEGivenN = 1 - m.probabilityNoEmissionFrom(active);
+        double w = psms.weights[k];
+        term *= w / prior * probEGivenN + (1-w) / (1-prior) * (1-probEGivenN);
+      }
+      total += term;
+      for(int k=0; k<n.size(); k++){
+        weightedState[k] += term * n[k].state / n[k].size;
+      }
+    }
+    Array<double> result(n.size());
+    for(int k=0; k<n.size(); k++){
+      result[k] = weightedState[k] / total;
+    }
+    return result;
+  }
+
+  BasicBigraph bigraph;
+};
+
+TEST_F(FidoGroupGraphTest, SweepMatchesBruteForce){
+  BasicGroupBigraph groupGraph(bigraph);
+  const Array<Counter> & groups = groupGraph.getOriginalN();
+  EXPECT_EQ(5,groups.size());
+  int configurations = 1;
+  for(int k=0; k<groups.size(); k++){
+    configurations *= groups[k].size + 1;
+  }
+  EXPECT_EQ(72,configurations);
+  EXPECT_NEAR(log2(72.0),groupGraph.logNumberOfConfigurations(),1e-12);
+
+  double alphas[2] = {0.1, 0.4};
+  double betas[2] = {0.01, 0.05};
+  vector<double> gammas;
+  gammas.push_back(0.1);
+  gammas.push_back(0.5);
+  gammas.push_back(0.75);
+  for(int a=0; a<2; a++){
+    vector<Array<double> > sweeps;
+    groupGraph.computeProteinProbs(alphas[a],betas[a],gammas,sweeps);
+    EXPECT_EQ(gammas.size(),sweeps.size());
+    for(size_t g=0; g<gammas.size(); g++){
+      Model m(alphas[a],betas[a],gammas[g]);
+      Array<double> expected = bruteForce(groupGraph,m);
+      Array<double> sweep = groupGraph.computeProteinProbs(m);
+      EXPECT_EQ(expected.size(),sweep.size());
+      EXPECT_EQ(expected.size(),sweeps[g].size());
+      for(int k=0; k<expected.size(); k++){
+        EXPECT_NEAR(expected[k],sweep[k],1e-12);
+        EXPECT_NEAR(expected[k],sweeps[g][k],1e-12);
+      }
+    }
+  }
+}
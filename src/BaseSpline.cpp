@@ -542,30 +542,3 @@ void BaseSpline::solveInPlace(PackedMatrix& mat, PackedVector& res) {
   }
   return;
 }
-
-void BaseSpline::testPerformance(){
-  cout << "\nTesting performance for fido:\n";
-  PackedVector v;
-  PackedMatrix M1;
-  PackedMatrix M2;
-  for (int n= 500; n <= 1000; n+=100){
-    cout << "********** " << "\n";
-    cout << "MATRIX DIM: " << n << "\n";
-    cout << "********** "<< "\n";
-    double s = 2.0;
-    v = PackedVector(n,3.0);
-    M1 = PackedMatrix(n,n);
-    M2 = PackedMatrix(n,n);
-    for (signed i = 0; i < signed (n); ++ i){
-      for (signed j = max (i-1, 0); j < min (i+2, signed (n)); ++ j){
-        M1[i].packedAddElement(j, 3 * i + j);
-        M2[i].packedAddElement(j, 2 * i + j);
-      }
-    }
-    M1.packedMultiply(s);
-    M1.packedMultiply(v);
-    M1.packedAdd(M2);
-    M1.packedMultiply(M2);
-    cout << endl;
-  }
-}
@@ -65,7 +65,6 @@ class BaseSpline {
     double alphaLinearSearchBA(double min_p, double max_p,
                                double p1, double p2,
                                double cv1, double cv2);
-    void testPerformance();
     Transform transf;
 
     PackedMatrix Q, Qt, R;
@@ -64,7 +64,7 @@ static const XMLCh fragSpectrumScanStr[] = { chLatin_f, chLatin_r,
 Caller::Caller() :
         pNorm(NULL), pCheck(NULL), svmInput(NULL), protEstimator(NULL),
         forwardTabInputFN(""), decoyWC(""), resultFN(""), tabFN(""),
-        xmlInputFN(""), xmlOutputFN(""), weightFN(""),
+        xmlInputFN(""), xmlOutputFN(""), weightFN(""), profileFN(""),
         tabInput(false), readStdIn(false),
         docFeatures(false), quickValidation(false), reportPerformanceEachIteration(false),
         reportUniquePeptides(true), calculateProteinLevelProb(false),
@@ -84,6 +84,7 @@ Caller::Caller() :
     fido_trivialGrouping = false;
     fido_depth = 0;
     fido_mse_threshold = 0.1;
+    fido_gibbsSweeps = 0;
     /* general protein probabilities options */
     tiesAsOneProtein = false;
     usePi0 = false;
@@ -363,6 +364,20 @@ bool Caller::parseOptions(int argc, char **argv) {
       "Uses protein group level inference, each cluster of proteins is either present or not, therefore when grouping proteins discard all possible combinations for each group.(Only valid if option -A is active and -N is inactive).",
       "",
       TRUE_IF_SET);
+  cmd.defineOption("L",
+      "fido-gibbs-sweeps",
+      "Protein graph components that are too large to be enumerated are not pruned but estimated with a Gibbs sampler \
+       that runs the given number of sweeps, seeded by the -S seed (Only valid if option -A is active). Default value is 0 (prune them)",
+      "value");
+  cmd.defineOption("y",
+      "profile-out",
+      "Output the wall time, cpu time, throughput and memory usage of each processing phase to the given file in JSON format",
+      "filename");
+  cmd.defineOption("M",
+      "max-memory",
+      "Stop with an error message as soon as the memory used by the PSMs, score lists, training buffers and protein graph, \
+      or the resident set size of the process, exceeds the given number of megabytes",
+      "MB");
   
   // finally parse and handle return codes (display help etc...)
   cmd.parseArgs(argc, argv);
@@ -405,6 +420,7 @@ bool Caller::parseOptions(int argc, char **argv) {
     if (cmd.optionSet("b"))  fido_beta = cmd.getDouble("b", 0.00, 1.0);
     if (cmd.optionSet("G"))  fido_gamma = cmd.getDouble("G", 0.00, 1.0);
     if (cmd.optionSet("H"))  fido_mse_threshold = cmd.getDouble("H",0.001,1.0);
+    if (cmd.optionSet("L"))  fido_gibbsSweeps = cmd.getInt("L", 0, 1000000);
 
   }
   
@@ -459,6 +475,13 @@ bool Caller::parseOptions(int argc, char **argv) {
   if (cmd.optionSet("w")) {
     weightFN = cmd.options["w"];
   }
+  if (cmd.optionSet("y")) {
+    profileFN = cmd.options["y"];
+  }
+  if (cmd.optionSet("M")) {
+    double maxMB = cmd.getDouble("M", 1.0, 1e9);
+    Globals::getInstance()->getProfiler()->setMaxMemory((size_t)(maxMB * 1048576.0));
+  }
   if (cmd.optionSet("W")) {
     SanityCheck::setInitWeightFN(cmd.options["W"]);
   }
@@ -745,6 +768,7 @@ int Caller::xv_process_one_bin(unsigned int set, vector<vector<double> >& w, boo
                                vector<double>& cfrac_vec, double &best_cpos, double &best_cfrac, vector_double* pWeights,
 options * pOptions) {
   int bestTP = 0;
+  ProfileScope phase("fold " + boost::lexical_cast<string>(set + 1));
   if (VERB > 2) {
     cerr << "cross calidation - fold " << set + 1 << " out of "
          << xval_fold << endl;
@@ -757,6 +781,7 @@ options * pOptions) {
   }
   xv_train[set].generateNegativeTrainingSet(*svmInput, 1.0);
   xv_train[set].generatePositiveTrainingSet(*svmInput, selectionfdr, 1.0);
+  phase.setItems(svmInput->positives + svmInput->negatives);
   if (VERB > 2) {
     cerr << "Calling with " << svmInput->positives << " positives and "
          << svmInput->negatives << " negatives\n";
@@ -848,6 +873,7 @@ void Caller::train(vector<vector<double> >& w) {
   // iterate
   int foundPositivesOldOld=0, foundPositivesOld=0, foundPositives=0; 
   for (unsigned int i = 0; i < niter; i++) {
+    ProfileScope phase("iteration " + boost::lexical_cast<string>(i + 1));
     if (VERB > 1) {
       cerr << "Iteration " << i + 1 << " :\t";
     }
@@ -882,6 +908,8 @@ void Caller::train(vector<vector<double> >& w) {
     printWeights(cerr, w[0]);
   }
   foundPositives = 0;
+  ProfileScope phase("test");
+  phase.setItems(fullset.size());
   for (size_t set = 0; set < xval_fold; ++set) {
     if (docFeatures) {
       xv_test[set].getDOC().copyDOCparameters(xv_train[set].getDOC());
@@ -1106,13 +1134,14 @@ void Caller::writeXML(){
   os.close();
 }
 
-void Caller::calculatePSMProb(bool isUniquePeptideRun,Scores *fullset, time_t& procStart,
-    clock_t& procStartClock, vector<vector<double> >& w, double& diff, bool TDC){
+void Caller::calculatePSMProb(bool isUniquePeptideRun,Scores *fullset,
+    vector<vector<double> >& w, bool TDC){
   // write output (cerr or xml) if this is the unique peptide run and the
   // reportUniquePeptides option was switched on OR if this is not the unique
   // peptide run and the option was switched off
   
   bool writeOutput = (isUniquePeptideRun == reportUniquePeptides);
+  ProfileScope phase(isUniquePeptideRun ? "peptide statistics" : "psm statistics");
   
   if (reportUniquePeptides && VERB > 0 && writeOutput) {
     cerr << "Tossing out \"redundant\" PSMs keeping only the best scoring PSM "
@@ -1121,14 +1150,22 @@ void Caller::calculatePSMProb(bool isUniquePeptideRun,Scores *fullset, time_t& p
   
   if(isUniquePeptideRun)
   {
-    fullset->weedOutRedundant();
+    ProfileScope weedOut("weed out");
+    weedOut.setItems(fullset->size());
+    fullset->weedOutRedundant(false);
   }
   else
   {
-    fullset->merge(xv_test, selectionfdr);
+    {
+      ProfileScope merge("merge");
+      fullset->merge(xv_test, selectionfdr, false);
+      merge.setItems(fullset->size());
+    }
     if(TDC)
     {
-       fullset->weedOutRedundantTDC();
+      ProfileScope weedOut("target decoy competition");
+      weedOut.setItems(fullset->size());
+      fullset->weedOutRedundantTDC(false);
 	if(VERB > 0)
 	{
 	  std::cerr << "Target Decoy Competition yielded " << fullset->posSize() << " target PSMs and " 
@@ -1136,6 +1173,12 @@ void Caller::calculatePSMProb(bool isUniquePeptideRun,Scores *fullset, time_t& p
 	}
     }
   }
+  {
+    ProfileScope pi0("pi0");
+    pi0.setItems(fullset->size());
+    fullset->estimatePi0();
+  }
+  updateScoresMemory();
   
   if (VERB > 0 && writeOutput) {
     std:cerr << "Selecting pi_0=" << fullset->getPi0() << endl;
@@ -1143,8 +1186,17 @@ void Caller::calculatePSMProb(bool isUniquePeptideRun,Scores *fullset, time_t& p
   if (VERB > 0 && writeOutput) {
     cerr << "Calibrating statistics - calculating q values" << endl;
   }
-  int foundPSMs = fullset->calcQ(test_fdr);
-  fullset->calcPep();
+  int foundPSMs = 0;
+  {
+    ProfileScope qvalues("q-values");
+    qvalues.setItems(fullset->size());
+    foundPSMs = fullset->calcQ(test_fdr);
+  }
+  {
+    ProfileScope pep("pep");
+    pep.setItems(fullset->size());
+    fullset->calcPep();
+  }
   if (VERB > 0 && docFeatures && writeOutput) {
     cerr << "For the cross validation sets the average deltaMass are ";
     for (size_t ix = 0; ix < xv_test.size(); ix++) {
@@ -1166,18 +1218,17 @@ void Caller::calculatePSMProb(bool isUniquePeptideRun,Scores *fullset, time_t& p
     << "Calibrating statistics - calculating Posterior error probabilities (PEPs)"
     << endl;
   }
-  time_t end;
-  time(&end);
-  diff = difftime(end, procStart);
+  Profiler* prof = Globals::getInstance()->getProfiler();
   ostringstream timerValues;
   timerValues.precision(4);
-  timerValues << "Processing took "
-      << ((double)(clock() - procStartClock)) / (double)CLOCKS_PER_SEC;
-  timerValues << " cpu seconds or " << diff << " seconds wall time"
-      << endl;
+  timerValues << "Processing took " << prof->getPhaseCpuTime("processing");
+  timerValues << " cpu seconds or " << prof->getPhaseWallTime("processing")
+      << " seconds wall time" << endl;
   if (VERB > 1 && writeOutput) {
     cerr << timerValues.str();
   }
+  ProfileScope output("output");
+  output.setItems(fullset->size());
   if (weightFN.size() > 0) {
     ofstream weightStream(weightFN.data(), ios::out);
     for (unsigned int ix = 0; ix < xval_fold; ++ix) {
@@ -1223,15 +1274,12 @@ void Caller::calculatePSMProb(bool isUniquePeptideRun,Scores *fullset, time_t& p
 
 void Caller::calculateProteinProbabilitiesFido()
 {
-  time_t startTime;
-  clock_t startClock;
-  time(&startTime);
-  startClock = clock();  
-
+  ProfileScope phase("protein inference");
 
   protEstimator = new FidoInterface(fido_alpha,fido_beta,fido_gamma,fido_nogrouProteins,fido_noseparate,
 				      fido_noprune,fido_depth,fido_reduceTree,fido_truncate,fido_mse_threshold,
-				      tiesAsOneProtein,usePi0,outputEmpirQVal,decoy_prefix,fido_trivialGrouping);
+				      tiesAsOneProtein,usePi0,outputEmpirQVal,decoy_prefix,fido_trivialGrouping,
+				      fido_gibbsSweeps);
   
   if (VERB > 0)
   {
@@ -1242,20 +1290,20 @@ void Caller::calculateProteinProbabilitiesFido()
   protEstimator->initialize(&fullset);
   protEstimator->run();
   protEstimator->computeProbabilities();
-  protEstimator->computeStatistics();
-  
-  time_t procStart;
-  clock_t procStartClock = clock();
-  time(&procStart);
-  double diff_time = difftime(procStart, startTime);
+  {
+    ProfileScope statistics("statistics");
+    protEstimator->computeStatistics();
+  }
   
   if (VERB > 1) 
   {  
+    Profiler* prof = Globals::getInstance()->getProfiler();
     cerr << "Estimating Protein Probabilities took : "
-    << ((double)(procStartClock - startClock)) / (double)CLOCKS_PER_SEC
-    << " cpu seconds or " << diff_time << " seconds wall time" << endl;
+    << prof->getPhaseCpuTime() << " cpu seconds or " 
+    << prof->getPhaseWallTime() << " seconds wall time" << endl;
   }
   
+  ProfileScope output("output");
   protEstimator->printOut(resultFN,decoyOut);
   if (xmlOutputFN.size() > 0){
       writeXML_Proteins();
@@ -1265,27 +1313,35 @@ void Caller::calculateProteinProbabilitiesFido()
 int Caller::run() {  
 
   time(&startTime);
-  startClock = clock();
+  Profiler* prof = Globals::getInstance()->getProfiler();
   if (VERB > 0) {
     cerr << extendedGreeter();
   }
-  // populate tmp input file with cin information if option is enabled
-  if(readStdIn){
-    ofstream tmpInputFile;
-    tmpInputFile.open(xmlInputFN.c_str());
-    while(cin) {
-      char buffer[1000];
-      cin.getline(buffer, 1000);
-      tmpInputFile << buffer << endl;
+  {
+    ProfileScope phase("read");
+    // populate tmp input file with cin information if option is enabled
+    if(readStdIn){
+      ofstream tmpInputFile;
+      tmpInputFile.open(xmlInputFN.c_str());
+      while(cin) {
+        char buffer[1000];
+        cin.getline(buffer, 1000);
+        tmpInputFile << buffer << endl;
+      }
+      tmpInputFile.close();
     }
-    tmpInputFile.close();
+    
+    // Reading input files (pin or temporary file)
+    
+    if(!readFiles()) return 0;
+    phase.setItems(normal.getSize() + shuffled.getSize());
+  }
+  {
+    ProfileScope phase("normalize");
+    fillFeatureSets();
+    phase.setItems(fullset.size());
+    updateScoresMemory();
   }
-  
-  // Reading input files (pin or temporary file)
-  
-  if(!readFiles()) return 0;
-  
-  fillFeatureSets();
   
   // terminate xercesc
   if(xmlInputFN.size() != 0){
@@ -1299,63 +1355,92 @@ int Caller::run() {
     std::cerr << "FeatureNames::getNumFeatures(): "<< FeatureNames::getNumFeatures() << endl;
   }
   vector<vector<double> > w(xval_fold,vector<double> (FeatureNames::getNumFeatures()+ 1)), ww;
-  int firstNumberOfPositives = preIterationSetup(w);
+  int firstNumberOfPositives = 0;
+  {
+    ProfileScope phase("initial direction");
+    phase.setItems(fullset.size());
+    firstNumberOfPositives = preIterationSetup(w);
+    updateScoresMemory();
+  }
   if (VERB > 0) {
     cerr << "Estimating " << firstNumberOfPositives << " over q="
         << test_fdr << " in initial direction" << endl;
   }
   // Set up a first guess of w
-  time_t procStart;
-  clock_t procStartClock = clock();
-  time(&procStart);
-  double diff = difftime(procStart, startTime);
   if (VERB > 1) cerr << "Reading in data and feature calculation took "
-      << ((double)(procStartClock - startClock)) / (double)CLOCKS_PER_SEC
-      << " cpu seconds or " << diff << " seconds wall time" << endl;
-  if (VERB > 0) {
-    cerr << "---Training with Cpos";
-    if (selectedCpos > 0) {
-      cerr << "=" << selectedCpos;
-    } else {
-      cerr << " selected by cross validation";
+      << prof->getPhaseCpuTime() << " cpu seconds or " 
+      << prof->getPhaseWallTime() << " seconds wall time" << endl;
+  {
+    ProfileScope processing("processing");
+    if (VERB > 0) {
+      cerr << "---Training with Cpos";
+      if (selectedCpos > 0) {
+        cerr << "=" << selectedCpos;
+      } else {
+        cerr << " selected by cross validation";
+      }
+      cerr << ", Cneg";
+      if (selectedCneg > 0) {
+        cerr << "=" << selectedCneg;
+      } else {
+        cerr << " selected by cross validation";
+      }
+      cerr << ", fdr=" << selectionfdr << endl;
     }
-    cerr << ", Cneg";
-    if (selectedCneg > 0) {
-      cerr << "=" << selectedCneg;
-    } else {
-      cerr << " selected by cross validation";
+    {
+      ProfileScope phase("training");
+      train(w);
+      if (!pCheck->validateDirection(w)) {
+        fullset.calcScores(w[0]);
+      }
+      updateScoresMemory();
+    }
+    if (VERB > 0) {
+      cerr << "Merging results from " << xv_test.size() << " datasets"
+          << endl;
     }
-    cerr << ", fdr=" << selectionfdr << endl;
-  }
-  train(w);
-  if (!pCheck->validateDirection(w)) {
-    fullset.calcScores(w[0]);
-  }
-  if (VERB > 0) {
-    cerr << "Merging results from " << xv_test.size() << " datasets"
-        << endl;
-  }
 
-  // calculate psms level probabilities
-  
-  //PSM probabilities TDA or TDC
-  calculatePSMProb(false, &fullset, procStart, procStartClock, w, diff, target_decoy_competition);
-  if (xmlOutputFN.size() > 0){
-    writeXML_PSMs();
-  }
-  
-  // calculate unique peptides level probabilities WOTE
-  if(reportUniquePeptides){
-    calculatePSMProb(true, &fullset, procStart, procStartClock, w, diff, target_decoy_competition);
+    // calculate psms level probabilities
+    
+    //PSM probabilities TDA or TDC
+    calculatePSMProb(false, &fullset, w, target_decoy_competition);
     if (xmlOutputFN.size() > 0){
-      writeXML_Peptides();
+      ProfileScope phase("output");
+      writeXML_PSMs();
+    }
+    
+    // calculate unique peptides level probabilities WOTE
+    if(reportUniquePeptides){
+      calculatePSMProb(true, &fullset, w, target_decoy_competition);
+      if (xmlOutputFN.size() > 0){
+        ProfileScope phase("output");
+        writeXML_Peptides();
+      }
+    }
+    // calculate protein level probabilities with FIDO
+    if(calculateProteinLevelProb){
+      calculateProteinProbabilitiesFido();
     }
+    // write output to file
+    ProfileScope phase("output");
+    writeXML();  
   }
-  // calculate protein level probabilities with FIDO
-  if(calculateProteinLevelProb){
-    calculateProteinProbabilitiesFido();
+  if (VERB > 1) {
+    prof->printMemory(cerr);
+  }
+  if (!profileFN.empty()) {
+    prof->writeJSON(profileFN);
   }
-  // write output to file
-  writeXML();  
   return 0;
 }
+
+void Caller::updateScoresMemory() {
+  size_t bytes = fullset.getMemoryUsage();
+  for (size_t set = 0; set < xv_train.size(); ++set) {
+    bytes += xv_train[set].getMemoryUsage();
+  }
+  for (size_t set = 0; set < xv_test.size(); ++set) {
+    bytes += xv_test[set].getMemoryUsage();
+  }
+  Globals::getInstance()->getProfiler()->setMemory("Scores", bytes);
+}
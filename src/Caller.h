@@ -91,8 +91,8 @@ class Caller {
     Scores* getFullSet() {
       return &fullset;
     }
-    void calculatePSMProb(bool uniquePeptideRun, Scores *fullset, time_t& procStart,
-        clock_t& procStartClock, vector<vector<double> >& w, double& diff, bool TDC = false);
+    void calculatePSMProb(bool uniquePeptideRun, Scores *fullset,
+        vector<vector<double> >& w, bool TDC = false);
     
     void calculateProteinProbabilitiesFido();
     
@@ -123,6 +123,7 @@ class Caller {
     void writeXML_Peptides();
     void writeXML_Proteins();
     void writeXML();
+    void updateScoresMemory();
     
     Normalizer * pNorm;
     SanityCheck * pCheck;
@@ -136,6 +137,7 @@ class Caller {
     string resultFN;
     string tabFN;
     string weightFN;
+    string profileFN;
     string call;
     string otherCall;
     string decoyOut;
@@ -158,7 +160,6 @@ class Caller {
     double trainRatio;
     unsigned int niter;
     time_t startTime;
-    clock_t startClock;
     const static unsigned int xval_fold;
     vector<Scores> xv_train, xv_test;
     vector<double> xv_cposs, xv_cfracs;
@@ -179,6 +180,7 @@ class Caller {
     bool fido_truncate;
     unsigned fido_depth;
     double fido_mse_threshold;
+    unsigned fido_gibbsSweeps;
     /* general protein probabilities options */
     bool tiesAsOneProtein;
     bool usePi0;
@@ -28,6 +28,7 @@ static char buf[4096];
 
 DataSet::DataSet() {
   numSpectra = 0;
+  memoryUsage = 0;
   sqtFN = "";
   pattern = "";
   doPattern = false;
@@ -53,7 +54,31 @@ DataSet::~DataSet() {
     delete psms[i];
     psms[i] = NULL;
   }
+  Globals::getInstance()->getProfiler()->releaseMemory("DataSet", memoryUsage);
+}
+
+void DataSet::push_back_psm(PSMDescription* psm) {
+  size_t bytes = psmMemoryUsage(*psm);
+  Globals::getInstance()->getProfiler()->allocateMemory("DataSet", bytes);
+  memoryUsage += bytes;
+  psms.push_back(psm);
+  ++numSpectra;
+}
 
+size_t DataSet::psmMemoryUsage(const PSMDescription& psm) {
+  size_t bytes = sizeof(PSMDescription) + sizeof(PSMDescription*)
+      + psm.id.capacity() + psm.peptide.capacity();
+  set<string>::const_iterator it = psm.proteinIds.begin();
+  for (; it != psm.proteinIds.end(); ++it) {
+    bytes += sizeof(string) + 4 * sizeof(void*) + it->capacity();
+  }
+  if (psm.features) {
+    bytes += FeatureNames::getNumFeatures() * sizeof(double);
+  }
+  if (psm.retentionFeatures) {
+    bytes += RTModel::totalNumRTFeatures() * sizeof(double);
+  }
+  return bytes;
 }
 
 PSMDescription* DataSet::getNext(int& pos) {
@@ -71,7 +96,7 @@ PSMDescription* DataSet::getNext(int& pos) {
   return &feature[pos];
 }*/
 
-bool DataSet::writeTabData(ofstream& out, const string& lab) {
+bool DataSet::writeTabData(ostream& out, const string& lab) {
   int pos = -1;
   PSMDescription* pPSM = NULL;
   unsigned int nf = FeatureNames::getNumFeatures();
@@ -237,7 +262,6 @@ void DataSet::readTabData(ifstream& is, const vector<unsigned int>& ixs) {
     }
     std::string peptide_seq = "";
     buff >> peptide_seq;
-    cerr << peptide_seq << endl;
     //NOTE to check if the peptide sequence contains flanks or not
     if(peptide_seq.at(1) != '.' && peptide_seq.at(peptide_seq.size()-1) != '.')
     {
@@ -261,8 +285,7 @@ void DataSet::readTabData(ifstream& is, const vector<unsigned int>& ixs) {
       featureRow[m + 1] = abs(psms[i]->massDiff);
       featureRow[m + 2] = 0;
     }
-    psms.push_back(myPsm);
-    ++numSpectra;
+    push_back_psm(myPsm);
   }
 }
 
@@ -392,7 +415,6 @@ void DataSet::readPsm(const percolatorInNs::peptideSpectrumMatch& psm, unsigned
         myPsm->features[featureNum++] = 0;
       }
 
-      psms.push_back(myPsm);
-      ++numSpectra;
+      push_back_psm(myPsm);
   }
 }
@@ -90,11 +90,14 @@ class DataSet {
     
     PSMDescription* getNext(int& pos);
     
+    /** takes ownership of the psm and of its feature arrays **/
+    void push_back_psm(PSMDescription* psm);
+    
     void setRetentionTime(map<int, double>& scan2rt) {
       PSMDescription::setRetentionTime(psms, scan2rt);
     }
     
-    bool writeTabData(ofstream& out, const string& lab);
+    bool writeTabData(ostream& out, const string& lab);
     void readTabData(ifstream& dataStream, const vector<unsigned int> &ixs);
     void print_10features();
     void print_features();
@@ -109,6 +112,8 @@ class DataSet {
   protected:
     
     inline string decoratePeptide(const ::percolatorInNs::peptideType& peptide);
+    /** approximate number of bytes held by a psm and its feature arrays **/
+    static size_t psmMemoryUsage(const PSMDescription& psm);
 //     double isPngasef(const string& peptide);
     static bool calcDOC;
     static bool isotopeMass;
@@ -119,6 +124,7 @@ class DataSet {
     vector<PSMDescription*> psms;
     int label;
     int numSpectra;
+    size_t memoryUsage;
     string sqtFN;
     string pattern;
     string fileId;
@@ -80,7 +80,8 @@ int GetDecimalPlaces(double dbVal)
 FidoInterface::FidoInterface(double __alpha,double __beta,double __gamma,bool __nogroupProteins, 
 			      bool __noseparate, bool __noprune, unsigned __depth,bool __reduceTree, 
 			      bool __truncate, double mse_threshold,bool tiesAsOneProtein, bool usePi0, 
-			      bool outputEmpirQVal, std::string decoyPattern,bool __trivialGrouping)
+			      bool outputEmpirQVal, std::string decoyPattern,bool __trivialGrouping,
+			      unsigned __gibbsSweeps)
 			      :ProteinProbEstimator(tiesAsOneProtein,usePi0,outputEmpirQVal,decoyPattern)
 {
   alpha = __alpha;
@@ -94,6 +95,7 @@ FidoInterface::FidoInterface(double __alpha,double __beta,double __gamma,bool __
   reduceTree = __reduceTree;
   truncate = __truncate;
   threshold = mse_threshold;
+  gibbsSweeps = __gibbsSweeps;
   dogridSearch = false;
 }
 
@@ -101,6 +103,7 @@ FidoInterface::~FidoInterface()
 {  if(proteinGraph)
   {
     delete proteinGraph;
+    Globals::getInstance()->getProfiler()->setMemory("GroupPowerBigraph", 0);
   }
   proteinGraph = 0;
 
@@ -126,6 +129,7 @@ void FidoInterface::run()
   
   proteinGraph = new GroupPowerBigraph (alpha,beta,gamma,nogroupProteins,noseparate,noprune,trivialGrouping);
   proteinGraph->setMaxAllowedConfigurations(max_allow_configurations);
+  proteinGraph->setGibbsSweeps(gibbsSweeps);
   proteinGraph->setPeptidePrior(peptidePrior_local);
   
   if(reduceTree && dogridSearch)
@@ -157,20 +161,21 @@ void FidoInterface::run()
 void FidoInterface::computeProbabilities()
 {
   
-  proteinGraph->read(peptideScores);
-  
-  time_t startTime;
-  clock_t startClock;
-  time(&startTime);
-  startClock = clock();
+  {
+    ProfileScope phase("graph");
+    proteinGraph->read(peptideScores);
+    Globals::getInstance()->getProfiler()->setMemory("GroupPowerBigraph", proteinGraph->getMemoryUsage());
+  }
   
   if(mayufdr)
   {
+    ProfileScope phase("fdr estimate");
     computeFDR();
   }
   
   if(dogridSearch) 
   {
+    ProfileScope phase("grid search");
     if(VERB > 1) 
     {
       std::cerr << "The parameters for the model will be estimated by grid search.\n" << std::endl;
@@ -181,13 +186,10 @@ void FidoInterface::computeProbabilities()
     else
       gridSearch();
     
-    time_t procStart;
-    clock_t procStartClock = clock();
-    time(&procStart);
-    double diff = difftime(procStart, startTime);
+    Profiler* prof = Globals::getInstance()->getProfiler();
     if (VERB > 1) cerr << "Estimating the parameters took : "
-      << ((double)(procStartClock - startClock)) / (double)CLOCKS_PER_SEC
-      << " cpu seconds or " << diff << " seconds wall time" << endl;
+      << prof->getPhaseCpuTime() << " cpu seconds or " 
+      << prof->getPhaseWallTime() << " seconds wall time" << endl;
   }
 
   if(VERB > 1) 
@@ -204,7 +206,7 @@ void FidoInterface::computeProbabilities()
 
   if(dogridSearch && reduceTree)
   {
-    //NOTE lets create the tree again with all the members
+    //NOTE lets apply the full thresholds to the tree that was read for the grid search
     double local_protein_threshold = proteinThreshold;
     if(truncate) local_protein_threshold = 0.0;
     proteinGraph->setProteinThreshold(local_protein_threshold);
@@ -215,33 +217,41 @@ void FidoInterface::computeProbabilities()
     proteinGraph->setPruneProteins(noprune);
     proteinGraph->setTrivialGrouping(trivialGrouping);
     proteinGraph->setMultipleLabeledPeptides(allow_multiple_labeled_peptides);
-    proteinGraph->read(peptideScores);
+    ProfileScope phase("graph");
+    if(!proteinGraph->rethreshold())
+      proteinGraph->read(peptideScores);
+    Globals::getInstance()->getProfiler()->setMemory("GroupPowerBigraph", proteinGraph->getMemoryUsage());
   }
   
+  ProfileScope phase("inference");
   proteinGraph->setAlphaBetaGamma(alpha,beta,gamma);
   proteinGraph->getProteinProbs();
   pepProteins.clear();
   proteinGraph->getProteinProbsPercolator(pepProteins);
+  phase.setItems(pepProteins.size());
+  Globals::getInstance()->getProfiler()->setMemory("GroupPowerBigraph", proteinGraph->getMemoryUsage());
+  if(gibbsSweeps > 0) reportApproximation();
 }
 
 //NOTE almost entirely duplicated of computeProbabilities, it could be refactored
 void FidoInterface::computeProbabilitiesFromFile(ifstream &fin)
 {
   
-  proteinGraph->read(fin);
-  
-  time_t startTime;
-  clock_t startClock;
-  time(&startTime);
-  startClock = clock();
+  {
+    ProfileScope phase("graph");
+    proteinGraph->read(fin);
+    Globals::getInstance()->getProfiler()->setMemory("GroupPowerBigraph", proteinGraph->getMemoryUsage());
+  }
   
   if(mayufdr)
   {
+    ProfileScope phase("fdr estimate");
     computeFDR();
   }
   
   if(dogridSearch) 
   {
+    ProfileScope phase("grid search");
     if(VERB > 1) 
     {
       std::cerr << "The parameters for the model will be estimated by grid search.\n" << std::endl;
@@ -252,13 +262,10 @@ void FidoInterface::computeProbabilitiesFromFile(ifstream &fin)
     else
       gridSearch();
     
-    time_t procStart;
-    clock_t procStartClock = clock();
-    time(&procStart);
-    double diff = difftime(procStart, startTime);
+    Profiler* prof = Globals::getInstance()->getProfiler();
     if (VERB > 1) cerr << "Estimating the parameters took : "
-      << ((double)(procStartClock - startClock)) / (double)CLOCKS_PER_SEC
-      << " cpu seconds or " << diff << " seconds wall time" << endl;
+      << prof->getPhaseCpuTime() << " cpu seconds or " 
+      << prof->getPhaseWallTime() << " seconds wall time" << endl;
   }
 
   if(VERB > 1) 
@@ -275,7 +282,7 @@ void FidoInterface::computeProbabilitiesFromFile(ifstream &fin)
 
   if(dogridSearch && reduceTree)
   {
-    //NOTE lets create the tree again with all the members
+    //NOTE lets apply the full thresholds to the tree that was read for the grid search
     double local_protein_threshold = proteinThreshold;
     if(truncate) local_protein_threshold = 0.0;
     proteinGraph->setProteinThreshold(local_protein_threshold);
@@ -284,26 +291,54 @@ void FidoInterface::computeProbabilitiesFromFile(ifstream &fin)
     proteinGraph->setGroupProteins(nogroupProteins);
     proteinGraph->setSeparateProteins(noseparate);
     proteinGraph->setPruneProteins(noprune);
+    proteinGraph->setTrivialGrouping(trivialGrouping);
     proteinGraph->setMultipleLabeledPeptides(allow_multiple_labeled_peptides);
-    proteinGraph->read(fin);
+    ProfileScope phase("graph");
+    // the stream is consumed, the graph read from it is reused
+    proteinGraph->rethreshold();
+    Globals::getInstance()->getProfiler()->setMemory("GroupPowerBigraph", proteinGraph->getMemoryUsage());
   }
   
+  ProfileScope phase("inference");
   proteinGraph->setAlphaBetaGamma(alpha,beta,gamma);
   proteinGraph->getProteinProbs();
   pepProteins.clear();
   proteinGraph->getProteinProbsPercolator(pepProteins);
+  phase.setItems(pepProteins.size());
+  Globals::getInstance()->getProfiler()->setMemory("GroupPowerBigraph", proteinGraph->getMemoryUsage());
+  if(gibbsSweeps > 0) reportApproximation();
+}
+
+bool FidoInterface::writeGraph(const std::string &fn) const
+{
+  ofstream os(fn.c_str(), ios::out | ios::binary);
+  if(!os)
+  {
+    std::cerr << "Error: could not open " << fn << " to write the fido graph" << std::endl;
+    return false;
+  }
+  proteinGraph->writeBinary(os);
+  os.close();
+  return true;
+}
+
+void FidoInterface::reportApproximation()
+{
+  if(VERB > 1)
+  {
+    std::cerr << proteinGraph->getNumberApproximateSubgraphs() 
+      << " protein graph components were too large to enumerate and were estimated by Gibbs sampling" << std::endl;
+  }
+  if(VERB > 2)
+  {
+    std::cerr << "The largest absolute error of the sampler on the 10 largest enumerated components is : " 
+      << proteinGraph->getApproximationError(10) << std::endl;
+  }
 }
 
 void FidoInterface::gridSearch()
 {
-  double gamma_best, alpha_best, beta_best;
-  gamma_best = alpha_best = beta_best = -1.0;
-  double best_objective = -100000000;
-  std::vector<std::vector<std::string> > names;
-  std::vector<double> probs,empq,estq;
   std::vector<long double> gamma_search,beta_search,alpha_search;
-
-  double roc, mse,current_objective;
   
   switch(depth)
   {
@@ -344,6 +379,7 @@ void FidoInterface::gridSearch()
   if(gamma != -1)
     gamma_search = boost::assign::list_of(gamma);
   
+  std::vector<Model> grid;
   for (unsigned int i = 0; i < gamma_search.size(); i++)
   {
     double gamma_local = gamma_search[i];
@@ -354,42 +390,13 @@ void FidoInterface::gridSearch()
       
       for (unsigned int k = 0; k < beta_search.size(); k++)
       {
-
 	double beta_local = beta_search[k];
-	
-	proteinGraph->setAlphaBetaGamma(alpha_local, beta_local, gamma_local);
-	proteinGraph->getProteinProbs();
-	proteinGraph->getProteinProbsAndNames(names,probs);
-	getEstimated_and_Empirical_FDR(names,probs,empq,estq);
-	getROC_AUC(names,probs,roc);
-	getFDR_MSE(estq,empq,mse);
-	
-	current_objective = (lambda * roc) - fabs(((1-lambda) * (mse)));
-	
-	if(VERB > 2)
-	{
-	  std::cerr.precision(10);
-	  std::cerr << "Grid searching Alpha= "  << alpha_local << " Beta= " << beta_local << " Gamma= "  << gamma_local << std::endl;
-	  std::cerr.unsetf(std::ios::floatfield);
-	  std::cerr << "The ROC AUC estimated values is : " << roc <<  std::endl;
-	  std::cerr << "The MSE FDR estimated values is : " <<  mse << std::endl;
-	  std::cerr << "Objective function with second roc and mse is : " << current_objective << std::endl;
-	}  
-	if (current_objective > best_objective)
-	{
-	  best_objective = current_objective;
-	  gamma_best = gamma_local;
-	  alpha_best = alpha_local;
-	  beta_best = beta_local;
-	}
-
+	grid.push_back(Model(alpha_local, beta_local, gamma_local));
       }
     }
   }
   
-  alpha = alpha_best;
-  beta = beta_best;
-  gamma = gamma_best;
+  evaluateGrid(grid);
 }
 
 void FidoInterface::gridSearchOptimize()
@@ -400,13 +407,6 @@ void FidoInterface::gridSearchOptimize()
     std::cerr << "Running super grid search..." << std::endl;
   }
   
-  double gamma_best, alpha_best, beta_best;
-  gamma_best = alpha_best = beta_best = -1.0;
-  double best_objective = -100000000;
-  std::vector<std::vector<std::string> > names;
-  std::vector<double> probs,empq,estq; 
-  double roc,mse,current_objective;
-  
   double alpha_step = 0.05;
   double beta_step = 0.05;
   double gamma_step = 0.05;
@@ -436,6 +436,7 @@ void FidoInterface::gridSearchOptimize()
   
   //NOTE very annoying the residue error of the floats that get acummulated in every iteration
   
+  std::vector<Model> grid;
   for (double i = gamma_init; i <= gamma_limit; i+=gamma_step)
   { 
     double gamma_local = i;
@@ -450,46 +451,98 @@ void FidoInterface::gridSearchOptimize()
       {
        
 	double alpha_local = pow(10,k);
-	
-	proteinGraph->setAlphaBetaGamma(alpha_local, beta_local, gamma_local);
-	proteinGraph->getProteinProbs();
-	proteinGraph->getProteinProbsAndNames(names,probs);
-	getEstimated_and_Empirical_FDR(names,probs,empq,estq);
-	getROC_AUC(names,probs,roc);
-	getFDR_MSE(estq,empq,mse);
-	
-	current_objective = (lambda * roc) - fabs(((1-lambda) * (mse)));
-	
-	if(VERB > 2)
-	{
-	  std::cerr.precision(10);
-	  std::cerr << "Grid searching Alpha= "  << alpha_local << " Beta= " << beta_local << " Gamma= "  << gamma_local << std::endl;
-	  std::cerr.unsetf(std::ios::floatfield);
-	  std::cerr << "The ROC AUC estimated values is : " << roc <<  std::endl;
-	  std::cerr << "The MSE FDR estimated values is : " <<  mse << std::endl;
-	  std::cerr << "Objective function with second roc and mse is : " << current_objective << std::endl;
-	  
-	}    
-	if (current_objective > best_objective)
-	{
-	  best_objective = current_objective;
-	  gamma_best = gamma_local;
-	  alpha_best = alpha_local;
-	  beta_best = beta_local;
-	}
+	grid.push_back(Model(alpha_local, beta_local, gamma_local));
       }
     }
   }
   
+  evaluateGrid(grid);
+}
+
+void FidoInterface::evaluateGrid(const std::vector<Model> &grid)
+{
+  // the grid points only read the graph, so they are evaluated concurrently,
+  // each with its own buffers. Points that share alpha and beta only differ
+  // in the prior, so they are evaluated together from one enumeration of
+  // the graph. The best point is then chosen in grid order, which makes the
+  // choice the same as that of a serial search
+  int numPoints = grid.size();
+  std::vector<double> rocs(numPoints), mses(numPoints), objectives(numPoints);
+  
+  std::map<std::pair<double,double>, std::vector<int> > pointsByAlphaBeta;
+  for (int k = 0; k < numPoints; k++)
+  {
+    pointsByAlphaBeta[std::make_pair(grid[k].alpha, grid[k].beta)].push_back(k);
+  }
+  std::vector<std::vector<int> > tasks;
+  for (std::map<std::pair<double,double>, std::vector<int> >::const_iterator it = pointsByAlphaBeta.begin();
+       it != pointsByAlphaBeta.end(); ++it)
+  {
+    tasks.push_back(it->second);
+  }
+  int numTasks = tasks.size();
+  
+#pragma omp parallel for schedule(dynamic, 1)
+  for (int t = 0; t < numTasks; t++)
+  {
+    const std::vector<int> &points = tasks[t];
+    std::vector<double> gammas;
+    for (unsigned int i = 0; i < points.size(); i++)
+    {
+      gammas.push_back(grid[points[i]].gamma);
+    }
+    std::vector<Array<double> > proteinProbs;
+    proteinGraph->getProteinProbs(grid[points[0]].alpha, grid[points[0]].beta, gammas, proteinProbs);
+    
+    for (unsigned int i = 0; i < points.size(); i++)
+    {
+      int k = points[i];
+      std::vector<std::vector<std::string> > names;
+      std::vector<double> probs,empq,estq;
+      unsigned rocN = default_rocN;
+      
+      proteinGraph->getProteinProbsAndNames(proteinProbs[i],names,probs);
+      getEstimated_and_Empirical_FDR(names,probs,empq,estq,rocN);
+      getROC_AUC(names,probs,rocs[k],rocN);
+      getFDR_MSE(estq,empq,mses[k]);
+      
+      objectives[k] = (lambda * rocs[k]) - fabs(((1-lambda) * (mses[k])));
+    }
+  }
+  
+  double gamma_best, alpha_best, beta_best;
+  gamma_best = alpha_best = beta_best = -1.0;
+  double best_objective = -100000000;
+  
+  for (int k = 0; k < numPoints; k++)
+  {
+    if(VERB > 2)
+    {
+      std::cerr.precision(10);
+      std::cerr << "Grid searching Alpha= "  << grid[k].alpha << " Beta= " << grid[k].beta << " Gamma= "  << grid[k].gamma << std::endl;
+      std::cerr.unsetf(std::ios::floatfield);
+      std::cerr << "The ROC AUC estimated values is : " << rocs[k] <<  std::endl;
+      std::cerr << "The MSE FDR estimated values is : " <<  mses[k] << std::endl;
+      std::cerr << "Objective function with second roc and mse is : " << objectives[k] << std::endl;
+    }
+    if (objectives[k] > best_objective)
+    {
+      best_objective = objectives[k];
+      gamma_best = grid[k].gamma;
+      alpha_best = grid[k].alpha;
+      beta_best = grid[k].beta;
+    }
+  }
+  
   alpha = alpha_best;
   beta = beta_best;
   gamma = gamma_best;
-
 }
 
 
 void FidoInterface::getROC_AUC(const std::vector<std::vector<string> > &names,
-					  const std::vector<double> &probabilities, double &auc)
+					  const std::vector<double> &probabilities, double &auc,
+					  unsigned rocN)
 {
   /* Estimate ROC auc1 area as : (So - no(no + 1) / 2) / (no*n1)
    * where no = number of target
@@ -570,7 +623,8 @@ void FidoInterface::getROC_AUC(const std::vector<std::vector<string> > &names,
 void FidoInterface::getEstimated_and_Empirical_FDR(const std::vector<std::vector<string> > &names,
 							     const std::vector<double> &probabilities,
 							     std::vector<double> &empq,
-							     std::vector<double> &estq) 
+							     std::vector<double> &estq,
+							     unsigned &rocN) 
 {
   empq.clear();
   estq.clear();
@@ -62,7 +62,8 @@ class FidoInterface : public ProteinProbEstimator
     FidoInterface(double __alpha = -1,double __beta = -1,double __gamma = -1,bool __nogroupProteins = false, 
 		   bool __noseparate = false, bool __noprune = false, unsigned __depth = 0,bool __reduceTree = false, 
 		   bool __truncate = true, double mse_threshold = 0.1,bool tiesAsOneProtein = false, bool usePi0 = false, 
-		   bool outputEmpirQVal = false, std::string decoyPattern = "random",bool trivialGrouping = false);
+		   bool outputEmpirQVal = false, std::string decoyPattern = "random",bool trivialGrouping = false,
+		   unsigned gibbsSweeps = 0);
 
     virtual ~FidoInterface();
     
@@ -70,6 +71,9 @@ class FidoInterface : public ProteinProbEstimator
     
     void computeProbabilities();
     void computeProbabilitiesFromFile(ifstream &fin);
+    /** writes the graph as read in the binary format that computeProbabilitiesFromFile
+     *  also accepts, returns false if the file can not be opened **/
+    bool writeGraph(const std::string &fn) const;
     
     double getGamma(){return gamma;};
     double getBeta(){return beta;};
@@ -82,17 +86,25 @@ class FidoInterface : public ProteinProbEstimator
     /** fido extra functions to do the grid search for parameters alpha,betha and gamma **/
 
     void getROC_AUC(const std::vector<std::vector<string> > &names,
-		     const std::vector<double> &probabilities, double &auc);
+		     const std::vector<double> &probabilities, double &auc,
+		     unsigned rocN);
     
+    /** rocN is updated with the number of false positives to use for the ROC curve **/
     void getEstimated_and_Empirical_FDR(const std::vector<std::vector<string> > &names,
 					  const std::vector<double> &probabilities,
 					  std::vector<double> &empq,
-					  std::vector<double> &estq);
+					  std::vector<double> &estq,
+					  unsigned &rocN);
+    
+    /** reports the number of sampled subgraphs and the error of the sampler **/
+    void reportApproximation();
     
     void getFDR_MSE(const std::vector<double> &estFDR, const std::vector<double> &empFDR,double &mse);
     
     void gridSearch();
     void gridSearchOptimize();
+    /** evaluates the grid points concurrently and keeps the best parameters **/
+    void evaluateGrid(const std::vector<Model> &grid);
     
     double gamma;
     double alpha;
@@ -101,12 +113,12 @@ class FidoInterface : public ProteinProbEstimator
     bool reduceTree;
     bool truncate;
     unsigned int depth;
-    mutable unsigned int rocN;
     bool nogroupProteins;
     bool noseparate;
     bool noprune;
     bool dogridSearch;
     bool trivialGrouping;
+    unsigned gibbsSweeps;
     GroupPowerBigraph* proteinGraph;
 };
 
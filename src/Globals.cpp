@@ -27,6 +27,10 @@ Globals::~Globals() {
     delete log;
     log = 0;
   }
+  if (prof) {
+    delete prof;
+    prof = 0;
+  }
 }
 
 Globals::Globals() {
@@ -34,6 +38,7 @@ Globals::Globals() {
   verbose = 2;
   fileLog = std::string("");
   log = 0;
+  prof = 0;
   buffer_redirected = false;
 }
 
@@ -107,6 +112,13 @@ Logger* Globals::getLogger() {
   return log;
 }
 
+Profiler* Globals::getProfiler() {
+  if (!prof) {
+    prof = new Profiler();
+  }
+  return prof;
+}
+
 void Globals::initLogger() {
   if(!fileLog.empty())
   {
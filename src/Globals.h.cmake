@@ -123,6 +123,7 @@ limitations under the License.
 #include <time.h>
 #include <string>
 #include "Logger.h"
+#include "Profiler.h"
 #include "MyException.h"
 
 
@@ -137,6 +138,7 @@ class Globals {
     static Globals* getInstance();
     static void clean();
     Logger* getLogger();
+    Profiler* getProfiler();
     
     const std::string& getLogFile(){
       return fileLog;
@@ -163,6 +165,7 @@ class Globals {
     int verbose;
     static Globals* glob;
     Logger *log;
+    Profiler *prof;
     std::string fileLog;
     bool buffer_redirected;
     streambuf* save_sbuf_cerr;
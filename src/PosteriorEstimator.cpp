@@ -35,6 +35,7 @@ using namespace std;
 #include "Option.h"
 #include "PosteriorEstimator.h"
 #include "Transform.h"
+#include "RandomStream.h"
 #include "Globals.h"
 
 static unsigned int noIntevals = 500;
@@ -75,12 +76,13 @@ template<class T> void bootstrap_old(const vector<T>& in, vector<T>& out) {
 }
 
 template<class T> void bootstrap(const vector<T>& in, vector<T>& out,
-                                 size_t max_size = 1000) {
+                                 unsigned int replicate, size_t max_size = 1000) {
+  // each replicate draws from its own stream
+  RandomStream rnd(RandomStream::PSM_BOOTSTRAP, replicate);
   out.clear();
-  double n = in.size();
   size_t num_draw = min(in.size(), max_size);
   for (size_t ix = 0; ix < num_draw; ++ix) {
-    size_t draw = (size_t)((double)rand() / ((double)RAND_MAX + (double)1) * n);
+    size_t draw = rnd.below(in.size());
     out.push_back(in[draw]);
   }
   // sort in desending order
@@ -460,7 +462,7 @@ double PosteriorEstimator::estimatePi0(vector<double>& p,
   // Examine which lambda level that is most stable under bootstrap
   for (unsigned int boot = 0; boot < numBoot; ++boot) {
     // Create an array of bootstrapped p-values, and sort in ascending order.
-    bootstrap<double> (p, pBoot);
+    bootstrap<double> (p, pBoot, boot);
     n = pBoot.size();
     for (unsigned int ix = 0; ix < lambdas.size(); ++ix) {
       start = lower_bound(pBoot.begin(), pBoot.end(), lambdas[ix]);
@@ -0,0 +1,339 @@
+/*******************************************************************************
+ Copyright 2006-2012 Lukas Käll <lukas.kall@scilifelab.se>
+
+ Licensed under the Apache License, Version 2.0 (the "License");
+ you may not use this file except in compliance with the License.
+ You may obtain a copy of the License at
+
+ http://www.apache.org/licenses/LICENSE-2.0
+
+ Unless required by applicable law or agreed to in writing, software
+ distributed under the License is distributed on an "AS IS" BASIS,
+ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ See the License for the specific language governing permissions and
+ limitations under the License.
+
+ *******************************************************************************/
+
+#include <ctime>
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <algorithm>
+#include "Globals.h"
+#include "Profiler.h"
+
+#if defined (__WIN32__) || defined (__MINGW__) || defined (MINGW) || defined (_WIN32)
+  #include <windows.h>
+  #include <psapi.h>
+#else
+  #include <sys/time.h>
+  #include <sys/resource.h>
+#endif
+
+ProfilePhase::ProfilePhase(const string& __name, ProfilePhase* __parent) :
+  name(__name), parent(__parent), calls(0), items(0), wallTime(0.0),
+  cpuTime(0.0), wallStart(0.0), cpuStart(0.0), memoryAtEnd(0), memoryPeak(0) {
+}
+
+ProfilePhase::~ProfilePhase() {
+  for (size_t ix = 0; ix < children.size(); ++ix) {
+    delete children[ix];
+  }
+  children.clear();
+}
+
+ProfilePhase* ProfilePhase::getChild(const string& childName) {
+  for (size_t ix = 0; ix < children.size(); ++ix) {
+    if (children[ix]->name == childName) {
+      return children[ix];
+    }
+  }
+  children.push_back(new ProfilePhase(childName, this));
+  return children.back();
+}
+
+void ProfilePhase::writeJSON(ostream& os, unsigned indent) const {
+  string pad(indent, ' ');
+  os << pad << "{" << endl;
+  os << pad << "  \"name\": \"" << Profiler::jsonEscape(name) << "\"," << endl;
+  os << pad << "  \"calls\": " << calls << "," << endl;
+  os << pad << "  \"wall_s\": " << wallTime << "," << endl;
+  os << pad << "  \"cpu_s\": " << cpuTime << "," << endl;
+  os << pad << "  \"items\": " << items << "," << endl;
+  os << pad << "  \"items_per_s\": " << itemsPerSecond() << "," << endl;
+  os << pad << "  \"memory_bytes\": " << memoryAtEnd << "," << endl;
+  os << pad << "  \"memory_peak_bytes\": " << memoryPeak << "," << endl;
+  os << pad << "  \"phases\": [";
+  for (size_t ix = 0; ix < children.size(); ++ix) {
+    os << (ix == 0 ? "" : ",") << endl;
+    children[ix]->writeJSON(os, indent + 4);
+  }
+  os << (children.empty() ? "" : "\n" + pad + "  ") << "]" << endl;
+  os << pad << "}";
+}
+
+Profiler::Profiler() : root("total", NULL), memoryCurrent(0), memoryPeak(0),
+    maxMemory(0) {
+  current = &root;
+  root.calls = 1;
+  root.wallStart = getWallTime();
+  root.cpuStart = getCpuTime();
+}
+
+Profiler::~Profiler() {
+}
+
+void Profiler::begin(const string& name) {
+  if (maxMemory > 0 && (size_t)getPeakRSS() * 1024 > maxMemory) {
+    checkMemory("");
+  }
+  // addMemory walks the open phases from other threads, so the phase tree
+  // is changed under the same lock
+#pragma omp critical (profiler_memory)
+  {
+    current = current->getChild(name);
+    current->calls++;
+    current->memoryPeak = max(current->memoryPeak, memoryCurrent);
+    current->wallStart = getWallTime();
+    current->cpuStart = getCpuTime();
+  }
+}
+
+void Profiler::end(size_t items) {
+  bool unopened = false;
+#pragma omp critical (profiler_memory)
+  {
+    if (current == &root) {
+      unopened = true;
+    } else {
+      current->wallTime += getWallTime() - current->wallStart;
+      current->cpuTime += getCpuTime() - current->cpuStart;
+      current->items += items;
+      current->memoryAtEnd = memoryCurrent;
+      if (VERB > 3) {
+        cerr << "Leaving " << current->name << " with "
+             << memoryCurrent / 1048576.0 << " MB accounted memory (peak "
+             << current->memoryPeak / 1048576.0 << " MB)" << endl;
+      }
+      current = current->parent;
+    }
+  }
+  if (unopened && VERB > 3) {
+    cerr << "Warning: profiler phase closed without being opened" << endl;
+  }
+}
+
+void Profiler::allocateMemory(const string& subsystem, size_t bytes) {
+  // the accounting may be updated from several threads, e.g. by the
+  // converters reading the files of a metafile in parallel, so every access
+  // to it is in the profiler_memory critical section
+  bool exceeded;
+#pragma omp critical (profiler_memory)
+  {
+    exceeded = addMemory(subsystem, bytes);
+  }
+  if (exceeded) {
+    checkMemory(subsystem);
+  }
+}
+
+void Profiler::releaseMemory(const string& subsystem, size_t bytes) {
+#pragma omp critical (profiler_memory)
+  {
+    removeMemory(subsystem, bytes);
+  }
+}
+
+void Profiler::setMemory(const string& subsystem, size_t bytes) {
+  bool exceeded = false;
+#pragma omp critical (profiler_memory)
+  {
+    size_t old = memory[subsystem].current;
+    if (bytes > old) {
+      exceeded = addMemory(subsystem, bytes - old);
+    } else {
+      removeMemory(subsystem, old - bytes);
+    }
+  }
+  if (exceeded) {
+    checkMemory(subsystem);
+  }
+}
+
+bool Profiler::addMemory(const string& subsystem, size_t bytes) {
+  MemoryAccount& account = memory[subsystem];
+  account.current += bytes;
+  account.peak = max(account.peak, account.current);
+  memoryCurrent += bytes;
+  memoryPeak = max(memoryPeak, memoryCurrent);
+  for (ProfilePhase* phase = current; phase != NULL; phase = phase->parent) {
+    phase->memoryPeak = max(phase->memoryPeak, memoryCurrent);
+  }
+  return maxMemory > 0 && memoryCurrent > maxMemory;
+}
+
+void Profiler::removeMemory(const string& subsystem, size_t bytes) {
+  MemoryAccount& account = memory[subsystem];
+  bytes = min(bytes, account.current);
+  account.current -= bytes;
+  memoryCurrent -= bytes;
+}
+
+void Profiler::checkMemory(const string& subsystem) const {
+  ostringstream temp;
+  temp << "Error : the memory limit of " << maxMemory / 1048576.0
+       << " MB set with --max-memory was exceeded";
+  if (!subsystem.empty()) {
+    temp << " when " << subsystem << " allocated memory";
+  }
+  string phase;
+#pragma omp critical (profiler_memory)
+  {
+    if (current != &root) {
+      phase = current->name;
+    }
+  }
+  if (!phase.empty()) {
+    temp << " in phase " << phase;
+  }
+  temp << "." << endl;
+  printMemory(temp);
+  throw MyException(temp.str());
+}
+
+void Profiler::printMemory(ostream& os) const {
+  map<string, MemoryAccount> accounts;
+  size_t total, peak;
+#pragma omp critical (profiler_memory)
+  {
+    accounts = memory;
+    total = memoryCurrent;
+    peak = memoryPeak;
+  }
+  os << "Accounted memory usage, current and peak in MB:" << endl;
+  for (map<string, MemoryAccount>::const_iterator it = accounts.begin();
+      it != accounts.end(); ++it) {
+    os << "  " << it->first << "\t" << it->second.current / 1048576.0 << "\t"
+       << it->second.peak / 1048576.0 << endl;
+  }
+  os << "  total\t" << total / 1048576.0 << "\t"
+     << peak / 1048576.0 << endl;
+  os << "  peak resident set size " << getPeakRSS() / 1024.0 << " MB" << endl;
+}
+
+const ProfilePhase* Profiler::findOpenPhase(const string& name) const {
+  const ProfilePhase* phase = current;
+  while (!name.empty() && phase != &root && phase->name != name) {
+    phase = phase->parent;
+  }
+  return phase;
+}
+
+double Profiler::getPhaseWallTime(const string& name) const {
+  return getWallTime() - findOpenPhase(name)->wallStart;
+}
+
+double Profiler::getPhaseCpuTime(const string& name) const {
+  return getCpuTime() - findOpenPhase(name)->cpuStart;
+}
+
+void Profiler::writeJSON(ostream& os) const {
+  os << setprecision(9);
+  os << "{" << endl;
+  os << "  \"version\": \"" << VERSION << "\"," << endl;
+  os << "  \"peak_rss_kb\": " << getPeakRSS() << "," << endl;
+  // the root phase stays open, report it up to now
+  os << "  \"wall_s\": " << getWallTime() - root.wallStart << "," << endl;
+  os << "  \"cpu_s\": " << getCpuTime() - root.cpuStart << "," << endl;
+  map<string, MemoryAccount> accounts;
+  size_t total, peak;
+#pragma omp critical (profiler_memory)
+  {
+    accounts = memory;
+    total = memoryCurrent;
+    peak = memoryPeak;
+  }
+  os << "  \"memory_bytes\": " << total << "," << endl;
+  os << "  \"memory_peak_bytes\": " << peak << "," << endl;
+  os << "  \"memory\": {";
+  for (map<string, MemoryAccount>::const_iterator it = accounts.begin();
+      it != accounts.end(); ++it) {
+    os << (it == accounts.begin() ? "" : ",") << endl << "    \""
+       << jsonEscape(it->first) << "\": { \"current_bytes\": "
+       << it->second.current << ", \"peak_bytes\": " << it->second.peak << " }";
+  }
+  os << endl << "  }," << endl;
+  os << "  \"phases\": [";
+  for (size_t ix = 0; ix < root.children.size(); ++ix) {
+    os << (ix == 0 ? "" : ",") << endl;
+    root.children[ix]->writeJSON(os, 4);
+  }
+  os << endl << "  ]" << endl;
+  os << "}" << endl;
+}
+
+bool Profiler::writeJSON(const string& fn) const {
+  ofstream os(fn.c_str(), ios::out);
+  if (!os) {
+    cerr << "Error: could not open " << fn << " to write the profile" << endl;
+    return false;
+  }
+  writeJSON(os);
+  os.close();
+  return true;
+}
+
+double Profiler::getWallTime() {
+#if defined (__WIN32__) || defined (__MINGW__) || defined (MINGW) || defined (_WIN32)
+  return GetTickCount() / 1000.0;
+#else
+  struct timeval tv;
+  gettimeofday(&tv, NULL);
+  return tv.tv_sec + tv.tv_usec * 1e-6;
+#endif
+}
+
+double Profiler::getCpuTime() {
+  return ((double)clock()) / (double)CLOCKS_PER_SEC;
+}
+
+long Profiler::getPeakRSS() {
+#if defined (__WIN32__) || defined (__MINGW__) || defined (MINGW) || defined (_WIN32)
+  PROCESS_MEMORY_COUNTERS info;
+  GetProcessMemoryInfo(GetCurrentProcess(), &info, sizeof(info));
+  return (long)(info.PeakWorkingSetSize / 1024);
+#else
+  struct rusage usage;
+  if (getrusage(RUSAGE_SELF, &usage) != 0) {
+    return 0;
+  }
+#if defined (__APPLE__)
+  return usage.ru_maxrss / 1024; // bytes on OS X
+#else
+  return usage.ru_maxrss; // kilobytes on Linux
+#endif
+#endif
+}
+
+string Profiler::jsonEscape(const string& in) {
+  string out;
+  for (size_t ix = 0; ix < in.size(); ++ix) {
+    switch (in[ix]) {
+      case '"': out += "\\\""; break;
+      case '\\': out += "\\\\"; break;
+      case '\n': out += "\\n"; break;
+      case '\t': out += "\\t"; break;
+      default: out += in[ix];
+    }
+  }
+  return out;
+}
+
+ProfileScope::ProfileScope(const string& name) : items(0) {
+  Globals::getInstance()->getProfiler()->begin(name);
+}
+
+ProfileScope::~ProfileScope() {
+  Globals::getInstance()->getProfiler()->end(items);
+}
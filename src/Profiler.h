@@ -0,0 +1,141 @@
+/*******************************************************************************
+ Copyright 2006-2012 Lukas Käll <lukas.kall@scilifelab.se>
+
+ Licensed under the Apache License, Version 2.0 (the "License");
+ you may not use this file except in compliance with the License.
+ You may obtain a copy of the License at
+
+ http://www.apache.org/licenses/LICENSE-2.0
+
+ Unless required by applicable law or agreed to in writing, software
+ distributed under the License is distributed on an "AS IS" BASIS,
+ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ See the License for the specific language governing permissions and
+ limitations under the License.
+
+ *******************************************************************************/
+
+#ifndef PROFILER_H_
+#define PROFILER_H_
+
+#include <string>
+#include <vector>
+#include <map>
+#include <iostream>
+
+using namespace std;
+
+/**
+ * One node of the phase tree. A phase that is entered several times under
+ * the same parent accumulates its calls, times and items in the same node.
+ */
+class ProfilePhase {
+  public:
+    ProfilePhase(const string& name, ProfilePhase* parent);
+    virtual ~ProfilePhase();
+    /** returns the child with the given name, creating it if needed **/
+    ProfilePhase* getChild(const string& childName);
+    double itemsPerSecond() const {
+      return (wallTime > 0.0 ? items / wallTime : 0.0);
+    }
+    void writeJSON(ostream& os, unsigned indent) const;
+
+    string name;
+    ProfilePhase* parent;
+    vector<ProfilePhase*> children;
+    unsigned calls;
+    size_t items;
+    double wallTime, cpuTime;
+    double wallStart, cpuStart;
+    /** accounted memory when the phase was last closed and at most while open **/
+    size_t memoryAtEnd, memoryPeak;
+};
+
+struct MemoryAccount {
+    MemoryAccount() : current(0), peak(0) {}
+    size_t current, peak;
+};
+
+/**
+ * Hierarchical phase profiler. Phases are opened with begin() and closed
+ * with end(), or preferably through a ProfileScope, and nest under the
+ * phase that was open when they began. The collected wall time, cpu time
+ * and item counts can be written as JSON with writeJSON().
+ *
+ * The profiler also keeps the memory accounting of the main data owners
+ * (DataSet, SetHandler, Scores, AlgIn, the fido graph and the converter
+ * databases), which report the bytes they hold per subsystem.
+ */
+class Profiler {
+  public:
+    Profiler();
+    virtual ~Profiler();
+    void begin(const string& name);
+    /** closes the innermost open phase and adds items to its count **/
+    void end(size_t items = 0);
+    /** wall and cpu seconds spent so far in the innermost open phase with
+     *  the given name, or in the innermost open phase if no name is given **/
+    double getPhaseWallTime(const string& name = "") const;
+    double getPhaseCpuTime(const string& name = "") const;
+
+    void allocateMemory(const string& subsystem, size_t bytes);
+    void releaseMemory(const string& subsystem, size_t bytes);
+    /** sets the usage of a subsystem that is measured rather than counted **/
+    void setMemory(const string& subsystem, size_t bytes);
+    /** makes the accounting throw a MyException as soon as the accounted
+     *  memory, or the peak resident set size at the start of a phase,
+     *  exceeds maxBytes. 0 disables the guard **/
+    void setMaxMemory(size_t maxBytes) {
+      maxMemory = maxBytes;
+    }
+    size_t getMaxMemory() const {
+      return maxMemory;
+    }
+    size_t getMemory() const {
+      return memoryCurrent;
+    }
+    size_t getPeakMemory() const {
+      return memoryPeak;
+    }
+    /** writes the current and peak usage per subsystem **/
+    void printMemory(ostream& os) const;
+
+    void writeJSON(ostream& os) const;
+    /** writes the JSON report to fn, returns false if it can not be opened **/
+    bool writeJSON(const string& fn) const;
+
+    /** wall clock time in seconds with sub-second resolution **/
+    static double getWallTime();
+    static double getCpuTime();
+    /** peak resident set size of the process in kilobytes, 0 if unknown **/
+    static long getPeakRSS();
+    static string jsonEscape(const string& in);
+
+  private:
+    const ProfilePhase* findOpenPhase(const string& name) const;
+    void checkMemory(const string& subsystem) const;
+    /** update the accounting, the caller holds the profiler_memory lock **/
+    bool addMemory(const string& subsystem, size_t bytes);
+    void removeMemory(const string& subsystem, size_t bytes);
+    ProfilePhase root;
+    ProfilePhase* current;
+    map<string, MemoryAccount> memory;
+    size_t memoryCurrent, memoryPeak, maxMemory;
+};
+
+/**
+ * Opens a phase for the lifetime of the object, so that the phase is also
+ * closed when an exception leaves the scope.
+ */
+class ProfileScope {
+  public:
+    ProfileScope(const string& name);
+    ~ProfileScope();
+    void setItems(size_t n) {
+      items = n;
+    }
+  private:
+    size_t items;
+};
+
+#endif /* PROFILER_H_ */
@@ -98,12 +98,32 @@ double hypergeometric(int x,int N,int w,int d)
   else return 0.0;
 }
 
+/** log_factorial for the integers 0..n, built incrementally so that every entry gives the
+ *  same value as log_factorial **/
+void extend_log_factorials(std::vector<double> &table, int n)
+{
+  if(table.empty()) table.push_back(0.0);
+  double log_fact = table.back();
+  for(int i = (int)table.size(); i <= n; i++)
+  {
+    if(i < 1000)
+    {
+      if(i >= 2) log_fact += log(i);
+      table.push_back(log_fact);
+    }
+    else
+    {
+      table.push_back(stirling_log_factorial(i));
+    }
+  }
+}
+
 /******************************************************************************************************************/
 
 ProteinFDRestimator::ProteinFDRestimator(std::string __decoy_prefix,unsigned __nbins, 
 					   double __targetDecoyRatio, bool __binequalDeepth)
 				          :decoy_prefix(__decoy_prefix),nbins(__nbins),
-				          targetDecoyRatio(__targetDecoyRatio),binequalDeepth(__binequalDeepth)
+				          targetDecoyRatio(__targetDecoyRatio),binequalDeepth(__binequalDeepth),binned(false)
 {
  
 }
@@ -113,6 +133,8 @@ ProteinFDRestimator::~ProteinFDRestimator()
   FreeAll(binnedProteins);
   FreeAll(groupedProteins);
   FreeAll(lenghts);
+  FreeAll(proteinNames);
+  FreeAll(logFactorials);
 }
 
 
@@ -165,6 +187,13 @@ void ProteinFDRestimator::correctIdenticalSequences(const std::map<std::string,s
     lenghts.push_back(length);
   }
   
+  //the bins refer to the proteins by their index in the sorted list of names
+  proteinNames.clear();
+  std::transform(groupedProteins.begin(), groupedProteins.end(), std::back_inserter(proteinNames), RetrieveValue());
+  std::sort(proteinNames.begin(),proteinNames.end());
+  proteinNames.erase(std::unique(proteinNames.begin(),proteinNames.end()),proteinNames.end());
+  binned = false;
+  
   if(VERB > 2)
   {
     std::cerr << "There have been " << num_corrected << " of identical sequences corrected to ''" << std::endl;
@@ -186,17 +215,18 @@ double ProteinFDRestimator::estimateFDR(const std::set<std::string> &__target, c
     time(&startTime);
     startClock = clock();
     
-    if(binnedProteins.size() > 0)
-    {
-       FreeAll(binnedProteins);
-    } 
-    if(binequalDeepth)
+    // the bins only depend on the protein lengths, they are kept between calls
+    if(!binned)
     {
-      binProteinsEqualDeepth();
-    }
-    else
-    {
-      binProteinsEqualWidth();
+      if(binequalDeepth)
+      {
+	binProteinsEqualDeepth();
+      }
+      else
+      {
+	binProteinsEqualWidth();
+      }
+      binned = true;
     }
     
     if(VERB > 2)
@@ -205,21 +235,41 @@ double ProteinFDRestimator::estimateFDR(const std::set<std::string> &__target, c
       << " decoys proteins that contains high confident PSMs\n" << std::endl;    
     }
 
+    // the proteins are marked by index once, the bins are then counted over integer arrays
+    std::vector<char> isTarget, isDecoy;
+    markProteins(__target,isTarget);
+    markProteins(__decoy,isDecoy);
+    
+    std::vector<unsigned> numberTP(nbins), numberFP(nbins), N(nbins);
+    unsigned maxN = 0;
+    for(unsigned i = 0; i < nbins; i++)
+    {
+      numberTP[i] = countMarked(i,isTarget);
+      numberFP[i] = countMarked(i,isDecoy);
+      N[i] = getBinProteins(i);
+      maxN = std::max(maxN,N[i]);
+    }
+    // the table has to cover every bin before the bins are evaluated in parallel
+    extend_log_factorials(logFactorials,maxN);
+    
+    std::vector<double> fp(nbins);
+#pragma omp parallel for schedule(dynamic, 1)
+    for(int i = 0; i < (int)nbins; i++)
+    {
+      fp[i] = estimatePi0HG(N[i],numberTP[i],targetDecoyRatio*numberFP[i]);
+    }
+
+    // summed in bin order, the result does not depend on the number of threads
     double fptol = 0.0;
     for(unsigned i = 0; i < nbins; i++)
     {
-      unsigned numberTP = countProteins(i,__target);
-      unsigned numberFP = countProteins(i,__decoy);
-      unsigned N = getBinProteins(i);
-      double fp = estimatePi0HG(N,numberTP,targetDecoyRatio*numberFP);
-      
       if(VERB > 2)
       {
-	  std::cerr << "\nEstimating FDR for bin " << i << " with " << numberFP << " Decoy proteins, "
-         << numberTP << " Target proteins, and " << N << " Total Proteins in the bin " << " with exp fp " << fp << std::endl;
+	  std::cerr << "\nEstimating FDR for bin " << i << " with " << numberFP[i] << " Decoy proteins, "
+         << numberTP[i] << " Target proteins, and " << N[i] << " Total Proteins in the bin " << " with exp fp " << fp[i] << std::endl;
       }
 
-      fptol += fp;
+      fptol += fp[i];
     }
   
     time_t procStart;
@@ -234,10 +284,9 @@ double ProteinFDRestimator::estimateFDR(const std::set<std::string> &__target, c
     return fptol ;
 }
 
-
-
 void ProteinFDRestimator::binProteinsEqualDeepth()
 {
+  binnedProteins.clear();
   //assuming lengths sorted from less to bigger
   std::sort(lenghts.begin(),lenghts.end());
   unsigned entries = lenghts.size();
@@ -256,7 +305,8 @@ void ProteinFDRestimator::binProteinsEqualDeepth()
   std::vector<double> values;
   for(unsigned i = 0; i <= nbins; i++)
   {
-    unsigned index = (unsigned)(nr_bins * i);
+    //without residues the upper bound of the last bin would be read past the end
+    unsigned index = std::min((unsigned)(nr_bins * i),entries - 1);
     double value = lenghts[index];
     values.push_back(value);
     if(VERB > 2)
@@ -280,9 +330,7 @@ void ProteinFDRestimator::binProteinsEqualDeepth()
     double upperbound = values[i+1];
     itlow = groupedProteins.lower_bound(lowerbound);
     itup =  groupedProteins.upper_bound(upperbound);
-    std::set<std::string> proteins;
-    std::transform(itlow, itup, std::inserter(proteins,proteins.begin()), RetrieveValue());
-    binnedProteins.insert(std::make_pair<unsigned,std::set<std::string> >(i,proteins));
+    addBin(itlow,itup);
   }
 
   return;
@@ -290,6 +338,7 @@ void ProteinFDRestimator::binProteinsEqualDeepth()
     
 void ProteinFDRestimator::binProteinsEqualWidth()
 {
+  binnedProteins.clear();
   //assuming lengths sorted from less to bigger
   std::sort(lenghts.begin(),lenghts.end());
   double min = lenghts.front();
@@ -317,24 +366,79 @@ void ProteinFDRestimator::binProteinsEqualWidth()
     double upperbound = values[i+1];
     itlow = groupedProteins.lower_bound(lowerbound);
     itup =  groupedProteins.upper_bound(upperbound);
-    std::set<std::string> proteins;
-    std::transform(itlow, itup, std::inserter(proteins,proteins.begin()), RetrieveValue());
-    binnedProteins.insert(std::make_pair<unsigned,std::set<std::string> >(i,proteins));
+    addBin(itlow,itup);
   }
 
   return;
 }
 
-double ProteinFDRestimator::estimatePi0HG(unsigned N,unsigned targets,unsigned cf)
+void ProteinFDRestimator::addBin(std::multimap<double,std::string>::const_iterator itlow,
+				 std::multimap<double,std::string>::const_iterator itup)
+{
+  std::vector<unsigned> proteins;
+  for(; itlow != itup; itlow++)
+  {
+    proteins.push_back(getProteinIndex(itlow->second));
+  }
+  std::sort(proteins.begin(),proteins.end());
+  proteins.erase(std::unique(proteins.begin(),proteins.end()),proteins.end());
+  binnedProteins.push_back(proteins);
+}
+
+unsigned ProteinFDRestimator::getProteinIndex(const std::string &protein) const
+{
+  std::vector<std::string>::const_iterator it = 
+    std::lower_bound(proteinNames.begin(),proteinNames.end(),protein);
+  if(it == proteinNames.end() || *it != protein) return proteinNames.size();
+  return it - proteinNames.begin();
+}
+
+void ProteinFDRestimator::markProteins(const std::set<std::string> &proteins, std::vector<char> &marked) const
+{
+  marked.assign(proteinNames.size(),0);
+  for(std::set<std::string>::const_iterator it = proteins.begin(); it != proteins.end(); it++)
+  {
+    unsigned index = getProteinIndex(*it);
+    if(index < proteinNames.size()) marked[index] = 1;
+  }
+}
+
+unsigned ProteinFDRestimator::countMarked(unsigned bin, const std::vector<char> &marked) const
+{
+  const std::vector<unsigned> &proteins = binnedProteins[bin];
+  unsigned count = 0;
+  for(unsigned i = 0; i < proteins.size(); i++)
+  {
+    count += marked[proteins[i]];
+  }
+  return count;
+}
+
+double ProteinFDRestimator::logFactorial(int n) const
+{
+  //as log_factorial, which gives 0 for negative arguments
+  if(n < 2) return 0.0;
+  if(n < (int)logFactorials.size()) return logFactorials[n];
+  return log_factorial(n);
+}
+
+double ProteinFDRestimator::logBinomial(int n, int k) const
+{
+  return logFactorial(n) - logFactorial(k) - logFactorial(n-k);
+}
+
+double ProteinFDRestimator::estimatePi0HG(unsigned N,unsigned targets,unsigned cf) const
 {
   std::vector<double> logprob;
   double finalprob = 0;
-  double fdr = 0;
+  //the denominator of the hypergeometric terms does not depend on fp
+  double logTotal = logBinomial(N,cf);
   for(unsigned fp = 0; fp <= cf; fp++)
   {
     unsigned tp = targets - fp;
-    unsigned w = N - tp;
-    double prob = hypergeometric(fp,N,w,cf);
+    int w = N - tp;
+    double prob = 0.0;
+    if(cf > 0) prob = exp(logBinomial(w,fp) + logBinomial(N-w,cf-fp) - logTotal);
     logprob.push_back(prob);
   }
   //normalization
@@ -353,18 +457,9 @@ double ProteinFDRestimator::estimatePi0HG(unsigned N,unsigned targets,unsigned c
 
 unsigned int ProteinFDRestimator::countProteins(unsigned int bin,const std::set<std::string> &proteins)
 {
-  std::set<std::string> proteinsBins = binnedProteins[bin];
-  unsigned count = 0;
-  for(std::set<std::string>::const_iterator it = proteins.begin(); it != proteins.end(); it++)
-  {
-    std::set<std::string>::iterator itfound = proteinsBins.find(*it);
-    if(itfound != proteinsBins.end())
-    {
-      count++;
-      proteinsBins.erase(itfound);
-    }
-  }
-  return count;
+  std::vector<char> marked;
+  markProteins(proteins,marked);
+  return countMarked(bin,marked);
 }
 
 
@@ -373,7 +468,6 @@ unsigned int ProteinFDRestimator::getBinProteins(unsigned int bin)
   return binnedProteins[bin].size();
 }
 
-
 unsigned int ProteinFDRestimator::getNumberBins()
 {
   return nbins;
@@ -403,11 +497,13 @@ void ProteinFDRestimator::setDecoyPrefix(std::string prefix)
 void ProteinFDRestimator::setEqualDeepthBinning(bool __equal_deepth)
 {
   binequalDeepth = __equal_deepth;
+  binned = false;
 }
 
 void ProteinFDRestimator::setNumberBins(unsigned int __nbins)
 {
   nbins = __nbins;
+  binned = false;
 }
 
 void ProteinFDRestimator::setTargetDecoyRatio(double __ratio)
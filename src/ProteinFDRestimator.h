@@ -113,8 +113,25 @@ private:
    already been counted wont count that already counted tryptic peptide to estimate its lenght **/
   void groupProteinsGene();
   
+  /** adds a bin with the proteins in the range of groupedProteins given **/
+  void addBin(std::multimap<double,std::string>::const_iterator itlow,
+	      std::multimap<double,std::string>::const_iterator itup);
+  
+  /** index of the protein in proteinNames, proteinNames.size() if it is not there **/
+  unsigned getProteinIndex(const std::string &protein) const;
+  
+  /** flags the proteins of the list given by their index **/
+  void markProteins(const std::set<std::string> &proteins, std::vector<char> &marked) const;
+  
+  /** return the number of proteins in bin i that are flagged **/
+  unsigned countMarked(unsigned bin, const std::vector<char> &marked) const;
+  
+  /** log factorial and log binomial coefficient, looked up in logFactorials when possible **/
+  double logFactorial(int n) const;
+  double logBinomial(int n, int k) const;
+  
   /** estimate the expected value of the hypergeometric distributions for N,TP and FP **/
-  double estimatePi0HG(unsigned N,unsigned TP,unsigned FP);
+  double estimatePi0HG(unsigned N,unsigned TP,unsigned FP) const;
   
   /** variables **/
   unsigned nbins;
@@ -125,9 +142,13 @@ private:
   //std::set<std::string> *decoy;
   bool binequalDeepth;
   std::string decoy_prefix;
-  std::map<unsigned,std::set<std::string> > binnedProteins;
+  //the bins are kept until the proteins or the binning change
+  bool binned;
+  std::vector<std::vector<unsigned> > binnedProteins;
   std::multimap<double,std::string> groupedProteins;
+  std::vector<std::string> proteinNames;
   std::vector<double> lenghts; 
+  std::vector<double> logFactorials;
 
 };
 #endif /* PROTEINFDRESTIMATOR_H_ */
\ No newline at end of file
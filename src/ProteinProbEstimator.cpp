@@ -18,17 +18,19 @@
 #include <iostream>
 #include <fstream>
 #include "ProteinProbEstimator.h"
+#include "RandomStream.h"
 
 /** Helper functions **/
 
 template<class T> 
 void bootstrap(const vector<T>& in, vector<T>& out,
-                                 size_t max_size = 1000) {
+                                 unsigned int replicate, size_t max_size = 1000) {
+  // each replicate draws from its own stream
+  RandomStream rnd(RandomStream::PROTEIN_BOOTSTRAP, replicate);
   out.clear();
-  double n = in.size();
   size_t num_draw = min(in.size(), max_size);
   for (size_t ix = 0; ix < num_draw; ++ix) {
-    size_t draw = (size_t)((double)rand() / ((double)RAND_MAX + (double)1) * n);
+    size_t draw = rnd.below(in.size());
     out.push_back(in[draw]);
   }
   // sort in desending order
@@ -357,7 +359,7 @@ double ProteinProbEstimator::estimatePi0(const unsigned int numBoot)
   for (unsigned int boot = 0; boot < numBoot; ++boot) 
   {
     // Create an array of bootstrapped p-values, and sort in ascending order.
-    bootstrap<double> (pvalues, pBoot);
+    bootstrap<double> (pvalues, pBoot, boot);
     n = pBoot.size();
     for (unsigned int ix = 0; ix < lambdas.size(); ++ix) 
     {
@@ -0,0 +1,68 @@
+/*******************************************************************************
+ Copyright 2006-2012 Lukas Käll <lukas.kall@scilifelab.se>
+
+ Licensed under the Apache License, Version 2.0 (the "License");
+ you may not use this file except in compliance with the License.
+ You may obtain a copy of the License at
+
+ http://www.apache.org/licenses/LICENSE-2.0
+
+ Unless required by applicable law or agreed to in writing, software
+ distributed under the License is distributed on an "AS IS" BASIS,
+ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ See the License for the specific language governing permissions and
+ limitations under the License.
+
+ *******************************************************************************/
+
+#include "RandomStream.h"
+
+uint32_t RandomStream::seed = 1;
+
+RandomStream::RandomStream(Domain domain, uint32_t __stream) :
+  key(makeKey(domain)), stream(__stream), position(0), spare(0),
+  haveSpare(false) {
+}
+
+uint32_t RandomStream::next() {
+  // every block gives two numbers, the counter is (position/2, stream)
+  if (haveSpare) {
+    haveSpare = false;
+    ++position;
+    return spare;
+  }
+  uint32_t x0 = position >> 1, x1 = stream;
+  philox(key, x0, x1);
+  if (position & 1) {
+    ++position;
+    return x1;
+  }
+  spare = x1;
+  haveSpare = true;
+  ++position;
+  return x0;
+}
+
+uint32_t RandomStream::draw(Domain domain, uint32_t stream, uint32_t counter) {
+  uint32_t x0 = counter >> 1, x1 = stream;
+  philox(makeKey(domain), x0, x1);
+  return (counter & 1 ? x1 : x0);
+}
+
+uint32_t RandomStream::makeKey(Domain domain) {
+  // a round of the bijection on (seed, domain) spreads nearby seeds apart
+  uint32_t x0 = seed, x1 = (uint32_t)domain;
+  philox(0xCA01F9DDu, x0, x1);
+  return x0 ^ x1;
+}
+
+void RandomStream::philox(uint32_t key, uint32_t& x0, uint32_t& x1) {
+  const uint32_t multiplier = 0xD256D193u, weyl = 0x9E3779B9u;
+  for (unsigned int round = 0; round < 10; ++round) {
+    uint64_t product = (uint64_t)multiplier * x0;
+    uint32_t hi = (uint32_t)(product >> 32), lo = (uint32_t)product;
+    x0 = hi ^ key ^ x1;
+    x1 = lo;
+    key += weyl;
+  }
+}
@@ -0,0 +1,78 @@
+/*******************************************************************************
+ Copyright 2006-2012 Lukas Käll <lukas.kall@scilifelab.se>
+
+ Licensed under the Apache License, Version 2.0 (the "License");
+ you may not use this file except in compliance with the License.
+ You may obtain a copy of the License at
+
+ http://www.apache.org/licenses/LICENSE-2.0
+
+ Unless required by applicable law or agreed to in writing, software
+ distributed under the License is distributed on an "AS IS" BASIS,
+ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ See the License for the specific language governing permissions and
+ limitations under the License.
+
+ *******************************************************************************/
+
+#ifndef RANDOMSTREAM_H_
+#define RANDOMSTREAM_H_
+
+#ifndef WIN32
+  #include <stdint.h>
+#endif
+
+#include <cstddef>
+
+/**
+ * Counter based random numbers (Philox-2x32-10, Salmon et al. 2011).
+ * A number is a pure function of the seed set with -S, a domain, a stream
+ * index within the domain (a fold, a bootstrap replicate, a fido component, ...)
+ * and a counter within the stream. Streams therefore do not share any state,
+ * and a loop over folds or replicates gives the same numbers whether it is
+ * run serially or in parallel, and in whatever order.
+ */
+class RandomStream {
+  public:
+    enum Domain {
+      XVAL_SPLIT = 1, XVAL_SPECTRUM, PSM_BOOTSTRAP, PROTEIN_BOOTSTRAP,
+      FIDO_GIBBS
+    };
+
+    RandomStream(Domain domain, uint32_t stream);
+    /** next 32 random bits of the stream **/
+    uint32_t next();
+    /** uniform in [0,1) **/
+    double uniform() {
+      return next() / 4294967296.0;
+    }
+    /** uniform integer in [0,n), n should be below 2^32 **/
+    size_t below(size_t n) {
+      return (size_t)(((uint64_t)next() * n) >> 32);
+    }
+    /** moves the stream to position counter, e.g. to the element an
+     *  iteration of a parallel loop is responsible for **/
+    void seek(uint32_t counter) {
+      position = counter;
+      haveSpare = false;
+    }
+
+    /** the random bits at position counter of the given stream, without
+     *  constructing a stream **/
+    static uint32_t draw(Domain domain, uint32_t stream, uint32_t counter);
+    static void setSeed(uint32_t s) {
+      seed = s;
+    }
+    static uint32_t getSeed() {
+      return seed;
+    }
+
+  private:
+    static void philox(uint32_t key, uint32_t& x0, uint32_t& x1);
+    static uint32_t makeKey(Domain domain);
+    uint32_t key, stream, position, spare;
+    bool haveSpare;
+    static uint32_t seed;
+};
+
+#endif /* RANDOMSTREAM_H_ */
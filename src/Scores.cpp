@@ -37,6 +37,7 @@ using namespace std;
 #include "PosteriorEstimator.h"
 #include "ssl.h"
 #include "MassHandler.h"
+#include "RandomStream.h"
 #include <boost/lexical_cast.hpp>
 #include <boost/algorithm/string.hpp>
 
@@ -209,7 +210,6 @@ ostream& operator<<(ostream& os, const ScoreHolderPeptide& sh)
 
 bool Scores::outxmlDecoys = false;
 bool Scores::showExpMass = false;
-uint32_t Scores::seed = 1;
 
 Scores::Scores() {
   pi0 = 1.0;
@@ -297,14 +297,6 @@ void Scores::fillFeatures(SetHandler& norm, SetHandler& shuff, bool reportUnique
   targetDecoySizeRatio = norm.getSize() / (double)shuff.getSize();
 }
 
-// Park–Miller random number generator
-// from wikipedia
-uint32_t Scores::lcg_rand() {
-  //uint64_t
-  seed = ((long unsigned int)seed * 279470273) % 4294967291;
-  return seed;
-}
-
 void Scores::createXvalSets(vector<Scores>& train, vector<Scores>& test,
     const unsigned int xval_fold) {
   train.resize(xval_fold);
@@ -315,20 +307,32 @@ void Scores::createXvalSets(vector<Scores>& train, vector<Scores>& test,
     remain[fold] = ix / (fold + 1);
     ix -= remain[fold];
   }
-  for (unsigned int j = 0; j < scores.size(); j++) {
-    ix = lcg_rand() % (scores.size() - j);
-    fold = 0;
-    while (ix > remain[fold]) {
-      ix -= remain[fold++];
+  // every PSM draws its own key from the split stream, the PSMs are then
+  // dealt to the folds in key order. The keys do not depend on each other,
+  // so the split is the same however they are computed
+  vector<pair<uint32_t, size_t> > keys(scores.size());
+  for (size_t j = 0; j < scores.size(); j++) {
+    keys[j] = make_pair(RandomStream::draw(RandomStream::XVAL_SPLIT, 0,
+        (uint32_t)j), j);
+  }
+  sort(keys.begin(), keys.end());
+  vector<unsigned int> folds(scores.size());
+  fold = 0;
+  for (size_t rank = 0; rank < keys.size(); rank++) {
+    while (remain[fold] == 0) {
+      ++fold;
     }
+    folds[keys[rank].second] = fold;
+    --remain[fold];
+  }
+  for (unsigned int j = 0; j < scores.size(); j++) {
     for (unsigned int i = 0; i < xval_fold; i++) {
-      if (i == fold) {
+      if (i == folds[j]) {
         test[i].scores.push_back(scores[j]);
       } else {
         train[i].scores.push_back(scores[j]);
       }
     }
-    --remain[fold];
   }
   vector<ScoreHolder>::const_iterator it;
   for (unsigned int i = 0; i < xval_fold; i++) {
@@ -387,8 +391,11 @@ void Scores::createXvalSetsBySpectrum(vector<Scores>& train, vector<Scores>&
   // put scores into the folders; choose a folder (at random) and change it only
   // when scores from a new spectra are encountered
   // note: this works because multimap is an ordered container!
+  // every spectrum draws its folder from its own stream
   unsigned int previousSpectrum = spectraScores.begin()->first;
-  size_t randIndex = lcg_rand() % xval_fold;
+  uint32_t spectrumIndex = 0;
+  RandomStream rnd(RandomStream::XVAL_SPECTRUM, spectrumIndex);
+  size_t randIndex = rnd.below(xval_fold);
   for (multimap<unsigned int, ScoreHolder>::iterator it = spectraScores.begin();
       it != spectraScores.end(); ++it) {
     // if current score is from a different spectra than the one encountered in
@@ -396,10 +403,11 @@ void Scores::createXvalSetsBySpectrum(vector<Scores>& train, vector<Scores>&
     
     //NOTE what if the folder if full but previousSpectrum is the same as current spectrum??
     if(previousSpectrum != (*it).first){
-      randIndex = lcg_rand() % xval_fold;
+      rnd = RandomStream(RandomStream::XVAL_SPECTRUM, ++spectrumIndex);
+      randIndex = rnd.below(xval_fold);
       // allow only indexes of folders that are non-full
       while(remain[randIndex] == 0){
-        randIndex = lcg_rand() % xval_fold;
+        randIndex = rnd.below(xval_fold);
       }
     }
     // insert
@@ -810,4 +818,18 @@ unsigned Scores::getQvaluesBelowLevel(double level) {
   }
   
   return hits;
-}
\ No newline at end of file
+}
+
+size_t Scores::getMemoryUsage() const {
+  size_t bytes = scores.capacity() * sizeof(ScoreHolder)
+      + w_vec.capacity() * sizeof(double)
+      + scoreMap.size() * (sizeof(pair<const double*, ScoreHolder*>) + 4 * sizeof(void*));
+  for (size_t ix = 0; ix < scores.size(); ix++) {
+    const vector<string>& psms = scores[ix].psms_list;
+    bytes += psms.capacity() * sizeof(string);
+    for (size_t jx = 0; jx < psms.size(); jx++) {
+      bytes += psms[jx].capacity();
+    }
+  }
+  return bytes;
+}
@@ -27,6 +27,7 @@
 using namespace std;
 #include "DescriptionOfCorrect.h"
 #include "PSMDescription.h"
+#include "RandomStream.h"
 #include "percolator_out.hxx"
 
 class SetHandler;
@@ -183,6 +184,10 @@ class Scores {
     /** Return the scores whose q value is less or equal than the threshold given**/
     unsigned getQvaluesBelowLevel(double level);
     
+    /** approximate number of bytes held by the score list, the PSMs are owned
+     *  and accounted by their DataSet **/
+    size_t getMemoryUsage() const;
+    
     void fill(string& fn);
     inline unsigned int size() {
       return (totalNumberOfTargets + totalNumberOfDecoys);
@@ -206,7 +211,7 @@ class Scores {
       return outxmlDecoys;
     }
     inline static void setSeed(uint32_t s) {
-      seed = s;
+      RandomStream::setSeed(s);
     }
     inline static void setShowExpMass(bool expmass) {
       showExpMass = expmass;
@@ -215,7 +220,6 @@ class Scores {
       return showExpMass;
     }
     
-    uint32_t lcg_rand();
     double pi0;
     double targetDecoySizeRatio;
     vector<ScoreHolder> scores;
@@ -227,7 +231,6 @@ class Scores {
     std::map<const double*, ScoreHolder*> scoreMap;
     DescriptionOfCorrect doc;
     static bool outxmlDecoys;
-    static uint32_t seed;
     static bool showExpMass;
 };
 
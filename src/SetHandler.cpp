@@ -21,6 +21,7 @@ SetHandler::SetHandler() {
   n_examples = 0;
   labels = NULL;
   c_vec = NULL;
+  memoryUsage = 0;
 }
 
 SetHandler::~SetHandler() {
@@ -38,6 +39,7 @@ SetHandler::~SetHandler() {
     }
     subsets[ix] = NULL;
   }
+  Globals::getInstance()->getProfiler()->releaseMemory("SetHandler", memoryUsage);
 }
 
 void SetHandler::filelessSetup(const unsigned int numFeatures,
@@ -126,9 +128,13 @@ void SetHandler::setSet() {
   }
   if (!labels) {
     labels = new double[n_examples];
+    memoryUsage += n_examples * sizeof(double);
+    Globals::getInstance()->getProfiler()->allocateMemory("SetHandler", n_examples * sizeof(double));
   }
   if (!c_vec) {
     c_vec = new double[n_examples];
+    memoryUsage += n_examples * sizeof(double);
+    Globals::getInstance()->getProfiler()->allocateMemory("SetHandler", n_examples * sizeof(double));
   }
   if (VERB > 3) {
     cerr << "Set up a SetHandler with " << subsets.size()
@@ -200,12 +206,7 @@ void SetHandler::readTab(const string& dataFN, const int setLabel) {
 void SetHandler::writeTab(const string& dataFN, const SetHandler& norm,
                           const SetHandler& shuff) {
   ofstream dataStream(dataFN.data(), ios::out);
-  dataStream << "SpecId\tLabel\t";
-  if (DataSet::getCalcDoc()) {
-    dataStream << "RT\tdM\t";
-  }
-  dataStream << DataSet::getFeatureNames().getFeatureNames(true)
-      << "\tPeptide\tProteins" << endl;
+  writeTabHeader(dataStream);
   string str;
   for (int setPos = 0; setPos < (signed int)norm.subsets.size(); setPos++) {
     norm.subsets[setPos]->writeTabData(dataStream,
@@ -219,3 +220,12 @@ void SetHandler::writeTab(const string& dataFN, const SetHandler& norm,
   }
   dataStream.close();
 }
+
+void SetHandler::writeTabHeader(ostream& dataStream) {
+  dataStream << "SpecId\tLabel\t";
+  if (DataSet::getCalcDoc()) {
+    dataStream << "RT\tdM\t";
+  }
+  dataStream << DataSet::getFeatureNames().getFeatureNames(true)
+      << "\tPeptide\tProteins" << endl;
+}
@@ -47,6 +47,7 @@ class SetHandler {
     double* labels;
     double* c_vec;
     int n_examples;
+    size_t memoryUsage;
     
   public:
     
@@ -75,6 +76,7 @@ class SetHandler {
     void readTab(const string& dataFN, const int label);
     static void writeTab(const string& dataFN, const SetHandler& norm,
                          const SetHandler& shuff);
+    static void writeTabHeader(ostream& dataStream);
     int const getLabel(int setPos);
     inline int const getTrainingSetSize() {
       return examples.size();
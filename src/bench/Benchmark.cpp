@@ -0,0 +1,148 @@
+/*******************************************************************************
+ Copyright 2006-2012 Lukas Käll <lukas.kall@scilifelab.se>
+
+ Licensed under the Apache License, Version 2.0 (the "License");
+ you may not use this file except in compliance with the License.
+ You may obtain a copy of the License at
+
+ http://www.apache.org/licenses/LICENSE-2.0
+
+ Unless required by applicable law or agreed to in writing, software
+ distributed under the License is distributed on an "AS IS" BASIS,
+ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ See the License for the specific language governing permissions and
+ limitations under the License.
+
+ *******************************************************************************/
+
+#include <algorithm>
+#include <numeric>
+#include <iomanip>
+#include <cmath>
+#include <ctime>
+#include "Globals.h"
+#include "Profiler.h"
+#include "Benchmark.h"
+
+double BenchmarkResult::percentile(double pct) const {
+  if (wallTimes.empty()) {
+    return 0.0;
+  }
+  vector<double> sorted(wallTimes);
+  sort(sorted.begin(), sorted.end());
+  size_t rank = (size_t)ceil(pct / 100.0 * sorted.size());
+  if (rank > 0) {
+    --rank;
+  }
+  return sorted[min(rank, sorted.size() - 1)];
+}
+
+double BenchmarkResult::meanWall() const {
+  if (wallTimes.empty()) {
+    return 0.0;
+  }
+  return accumulate(wallTimes.begin(), wallTimes.end(), 0.0) / wallTimes.size();
+}
+
+double BenchmarkResult::meanCpu() const {
+  if (cpuTimes.empty()) {
+    return 0.0;
+  }
+  return accumulate(cpuTimes.begin(), cpuTimes.end(), 0.0) / cpuTimes.size();
+}
+
+double BenchmarkResult::throughput() const {
+  double median = percentile(50.0);
+  return (median > 0.0 ? items / median : 0.0);
+}
+
+BenchmarkRunner::BenchmarkRunner(unsigned __repetitions, unsigned __warmup)
+  : repetitions(max(1u, __repetitions)), warmup(__warmup) {
+}
+
+BenchmarkRunner::~BenchmarkRunner() {
+  for (size_t ix = 0; ix < cases.size(); ++ix) {
+    delete cases[ix];
+  }
+  cases.clear();
+}
+
+void BenchmarkRunner::add(BenchmarkCase* bc) {
+  cases.push_back(bc);
+}
+
+BenchmarkResult BenchmarkRunner::runCase(BenchmarkCase& bc) {
+  BenchmarkResult res;
+  res.name = bc.getName();
+  long peakBefore = Profiler::getPeakRSS();
+  for (unsigned ix = 0; ix < warmup; ++ix) {
+    bc.setUp();
+    bc.run();
+    bc.tearDown();
+  }
+  for (unsigned ix = 0; ix < repetitions; ++ix) {
+    bc.setUp();
+    double wallStart = Profiler::getWallTime();
+    double cpuStart = Profiler::getCpuTime();
+    res.items = bc.run();
+    res.cpuTimes.push_back(Profiler::getCpuTime() - cpuStart);
+    res.wallTimes.push_back(Profiler::getWallTime() - wallStart);
+    bc.tearDown();
+  }
+  res.processPeakRSS = Profiler::getPeakRSS();
+  res.peakRSSGrowth = res.processPeakRSS - peakBefore;
+  return res;
+}
+
+void BenchmarkRunner::runAll() {
+  // cases added after a previous call are appended to the results
+  for (size_t ix = results.size(); ix < cases.size(); ++ix) {
+    if (VERB > 1) {
+      cerr << "Running benchmark " << cases[ix]->getName() << "..." << endl;
+    }
+    results.push_back(runCase(*cases[ix]));
+    if (VERB > 1) {
+      const BenchmarkResult& res = results.back();
+      cerr << "  " << res.items << " items, median " << res.percentile(50.0)
+           << " seconds wall time (" << res.throughput() << " items/s)" << endl;
+    }
+  }
+}
+
+void BenchmarkRunner::writeJSON(ostream& os) const {
+  os << setprecision(9);
+  os << "{" << endl;
+  os << "  \"version\": \"" << VERSION << "\"," << endl;
+  os << "  \"repetitions\": " << repetitions << "," << endl;
+  os << "  \"warmup\": " << warmup << "," << endl;
+  os << "  \"parameters\": {";
+  for (map<string, string>::const_iterator it = parameters.begin();
+      it != parameters.end(); ++it) {
+    os << (it == parameters.begin() ? "" : ",") << endl << "    \""
+       << Profiler::jsonEscape(it->first) << "\": \""
+       << Profiler::jsonEscape(it->second) << "\"";
+  }
+  os << endl << "  }," << endl;
+  os << "  \"peak_rss_kb\": " << Profiler::getPeakRSS() << "," << endl;
+  os << "  \"benchmarks\": [";
+  for (size_t ix = 0; ix < results.size(); ++ix) {
+    const BenchmarkResult& res = results[ix];
+    os << (ix == 0 ? "" : ",") << endl;
+    os << "    {" << endl;
+    os << "      \"name\": \"" << Profiler::jsonEscape(res.name) << "\"," << endl;
+    os << "      \"items\": " << res.items << "," << endl;
+    os << "      \"wall_mean_s\": " << res.meanWall() << "," << endl;
+    os << "      \"cpu_mean_s\": " << res.meanCpu() << "," << endl;
+    os << "      \"wall_min_s\": " << res.percentile(0.0) << "," << endl;
+    os << "      \"wall_p50_s\": " << res.percentile(50.0) << "," << endl;
+    os << "      \"wall_p90_s\": " << res.percentile(90.0) << "," << endl;
+    os << "      \"wall_p99_s\": " << res.percentile(99.0) << "," << endl;
+    os << "      \"wall_max_s\": " << res.percentile(100.0) << "," << endl;
+    os << "      \"items_per_s\": " << res.throughput() << "," << endl;
+    os << "      \"process_peak_rss_kb\": " << res.processPeakRSS << "," << endl;
+    os << "      \"peak_rss_growth_kb\": " << res.peakRSSGrowth << endl;
+    os << "    }";
+  }
+  os << endl << "  ]" << endl;
+  os << "}" << endl;
+}
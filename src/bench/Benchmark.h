@@ -0,0 +1,94 @@
+/*******************************************************************************
+ Copyright 2006-2012 Lukas Käll <lukas.kall@scilifelab.se>
+
+ Licensed under the Apache License, Version 2.0 (the "License");
+ you may not use this file except in compliance with the License.
+ You may obtain a copy of the License at
+
+ http://www.apache.org/licenses/LICENSE-2.0
+
+ Unless required by applicable law or agreed to in writing, software
+ distributed under the License is distributed on an "AS IS" BASIS,
+ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ See the License for the specific language governing permissions and
+ limitations under the License.
+
+ *******************************************************************************/
+
+#ifndef BENCHMARK_H_
+#define BENCHMARK_H_
+
+#include <string>
+#include <vector>
+#include <map>
+#include <iostream>
+
+using namespace std;
+
+/**
+ * One timed kernel. setUp() and tearDown() are called around every repetition
+ * and are not timed, run() is timed and returns the number of items (PSMs,
+ * peptides, proteins...) it processed so that throughput can be reported.
+ */
+class BenchmarkCase {
+  public:
+    BenchmarkCase(const string& name) : name(name) {}
+    virtual ~BenchmarkCase() {}
+    virtual void setUp() {}
+    virtual size_t run() = 0;
+    virtual void tearDown() {}
+    const string& getName() const {
+      return name;
+    }
+  protected:
+    string name;
+};
+
+class BenchmarkResult {
+  public:
+    BenchmarkResult() : items(0), processPeakRSS(0), peakRSSGrowth(0) {}
+    string name;
+    size_t items;
+    vector<double> wallTimes;
+    vector<double> cpuTimes;
+    /** peak resident set size of the whole process after the case in kB,
+     *  it includes the peaks of the cases that ran before **/
+    long processPeakRSS;
+    /** how much the case raised the process peak in kB, 0 if it stayed
+     *  below the peak of an earlier case **/
+    long peakRSSGrowth;
+    /** nearest rank percentile (0-100) of the wall times in seconds **/
+    double percentile(double pct) const;
+    double meanWall() const;
+    double meanCpu() const;
+    double throughput() const;
+};
+
+/**
+ * Runs a list of BenchmarkCase a fixed number of repetitions after some
+ * warm up runs and writes the collected statistics as JSON.
+ */
+class BenchmarkRunner {
+  public:
+    BenchmarkRunner(unsigned repetitions = 10, unsigned warmup = 1);
+    virtual ~BenchmarkRunner();
+    /** takes ownership of the case **/
+    void add(BenchmarkCase* bc);
+    void runAll();
+    void setParameter(const string& key, const string& value) {
+      parameters[key] = value;
+    }
+    void writeJSON(ostream& os) const;
+    const vector<BenchmarkResult>& getResults() const {
+      return results;
+    }
+  private:
+    BenchmarkResult runCase(BenchmarkCase& bc);
+    unsigned repetitions;
+    unsigned warmup;
+    vector<BenchmarkCase*> cases;
+    vector<BenchmarkResult> results;
+    map<string, string> parameters;
+};
+
+#endif /* BENCHMARK_H_ */
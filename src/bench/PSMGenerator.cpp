@@ -0,0 +1,395 @@
+/*******************************************************************************
+ Copyright 2006-2012 Lukas Käll <lukas.kall@scilifelab.se>
+
+ Licensed under the Apache License, Version 2.0 (the "License");
+ you may not use this file except in compliance with the License.
+ You may obtain a copy of the License at
+
+ http://www.apache.org/licenses/LICENSE-2.0
+
+ Unless required by applicable law or agreed to in writing, software
+ distributed under the License is distributed on an "AS IS" BASIS,
+ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ See the License for the specific language governing permissions and
+ limitations under the License.
+
+ *******************************************************************************/
+
+#include <sstream>
+#include <algorithm>
+#include <boost/lexical_cast.hpp>
+#include <xercesc/util/PlatformUtils.hpp>
+#include "Option.h"
+#include "Globals.h"
+#include "DataSet.h"
+#include "SetHandler.h"
+#include "FeatureNames.h"
+#include "serializer.hxx"
+#include "percolator_in.hxx"
+#include "PSMGenerator.h"
+
+PSMGenerator::PSMGenerator() :
+  numPSMs(100000), numFeatures(10), numProteins(2000), pi0(0.5),
+  sharedPeptideRate(0.2), peptideMultiplicity(2.0), separation(2.0),
+  minCharge(2), maxCharge(4), seed(1), decoyPrefix("random"), format(PIN),
+  outputFN(""), decoyOutputFN("") {
+}
+
+PSMGenerator::~PSMGenerator() {
+}
+
+string PSMGenerator::greeter() {
+  ostringstream oss;
+  oss << "psm-generator version " << VERSION << ", ";
+  oss << "Build Date " << __DATE__ << " " << __TIME__ << endl;
+  oss << "Generates seeded synthetic data sets for percolator, qvality and fido" << endl;
+  return oss.str();
+}
+
+bool PSMGenerator::parseOptions(int argc, char** argv) {
+  ostringstream intro;
+  intro << greeter() << endl;
+  intro << "Usage:" << endl;
+  intro << "   psm-generator [options]" << endl;
+  CommandLineParser cmd(intro.str());
+  cmd.defineOption("v",
+      "verbose",
+      "Set verbosity of output: 0=no processing info, 5=all, default is 2",
+      "level");
+  cmd.defineOption("F",
+      "format",
+      "Output format: pin, tab, qvality (target scores to -o, decoy scores to -d) or fido. Default is pin.",
+      "format");
+  cmd.defineOption("o",
+      "output",
+      "Write the data set to this file instead of stdout.",
+      "filename");
+  cmd.defineOption("d",
+      "decoy-output",
+      "File for the decoy scores of the qvality format.",
+      "filename");
+  cmd.defineOption("n",
+      "psms",
+      "Number of PSMs, one target and one decoy per spectrum. Default is 100000.",
+      "value");
+  cmd.defineOption("f",
+      "features",
+      "Number of features. Default is 10.",
+      "value");
+  cmd.defineOption("p",
+      "proteins",
+      "Number of target proteins, there are as many decoy proteins. Default is 2000.",
+      "value");
+  cmd.defineOption("z",
+      "pi0",
+      "Fraction of incorrect target PSMs. Default is 0.5.",
+      "value");
+  cmd.defineOption("s",
+      "shared-peptides",
+      "Fraction of the peptides that are shared with a second protein. Default is 0.2.",
+      "value");
+  cmd.defineOption("m",
+      "multiplicity",
+      "Average number of PSMs per peptide. Default is 2.",
+      "value");
+  cmd.defineOption("x",
+      "separation",
+      "Shift of the first feature of the correct PSMs, feature i is shifted by x/i. Default is 2.",
+      "value");
+  cmd.defineOption("S",
+      "seed",
+      "Seed of the random number generator. Default is 1.",
+      "value");
+  cmd.defineOption("P",
+      "pattern",
+      "Prefix of the decoy protein names. Default is random.",
+      "value");
+  cmd.parseArgs(argc, argv);
+
+  if (cmd.optionSet("v")) {
+    Globals::getInstance()->setVerbose(cmd.getInt("v", 0, 10));
+  }
+  if (cmd.optionSet("F")) {
+    string f = cmd.options["F"];
+    if (f == "pin") format = PIN;
+    else if (f == "tab") format = TAB;
+    else if (f == "qvality") format = QVALITY;
+    else if (f == "fido") format = FIDO;
+    else {
+      cerr << "Error: unknown output format " << f << endl;
+      return false;
+    }
+  }
+  if (cmd.optionSet("o")) outputFN = cmd.options["o"];
+  if (cmd.optionSet("d")) decoyOutputFN = cmd.options["d"];
+  if (cmd.optionSet("n")) numPSMs = boost::lexical_cast<size_t>(cmd.options["n"]);
+  if (cmd.optionSet("f")) numFeatures = cmd.getInt("f", 1, 1000);
+  if (cmd.optionSet("p")) numProteins = cmd.getInt("p", 1, 100000000);
+  if (cmd.optionSet("z")) pi0 = cmd.getDouble("z", 0.0, 1.0);
+  if (cmd.optionSet("s")) sharedPeptideRate = cmd.getDouble("s", 0.0, 1.0);
+  if (cmd.optionSet("m")) peptideMultiplicity = cmd.getDouble("m", 1.0, 1e6);
+  if (cmd.optionSet("x")) separation = cmd.getDouble("x", 0.0, 100.0);
+  if (cmd.optionSet("S")) seed = cmd.getInt("S", 1, 20000);
+  if (cmd.optionSet("P")) decoyPrefix = cmd.options["P"];
+  if (format == QVALITY && decoyOutputFN.empty()) {
+    cerr << "Error: the qvality format needs a file for the decoy scores (-d)" << endl;
+    return false;
+  }
+  return true;
+}
+
+int PSMGenerator::run() {
+  ofstream fileStream;
+  if (outputFN.size() > 0) {
+    fileStream.open(outputFN.c_str(), ios::out);
+    if (!fileStream) {
+      throw MyException("Error : Can not open file " + outputFN + "\n");
+    }
+  }
+  ostream& out = (outputFN.size() > 0 ? fileStream : cout);
+  if (VERB > 1) {
+    cerr << "Generating " << numPSMs << " PSMs with " << numFeatures
+         << " features, pi0=" << pi0 << " and " << numProteins << " proteins" << endl;
+  }
+  switch (format) {
+    case PIN:
+      writePin(out);
+      break;
+    case TAB:
+      writeTab(out);
+      break;
+    case QVALITY: {
+      ofstream decoys(decoyOutputFN.c_str(), ios::out);
+      writeQvality(out, decoys);
+      decoys.close();
+      break;
+    }
+    case FIDO:
+      writeFidoGraph(out);
+      break;
+  }
+  if (fileStream.is_open()) {
+    fileStream.close();
+  }
+  return true;
+}
+
+uint32_t PSMGenerator::hash(uint32_t x) {
+  x ^= x >> 16;
+  x *= 0x7feb352d;
+  x ^= x >> 15;
+  x *= 0x846ca68b;
+  x ^= x >> 16;
+  return x;
+}
+
+unsigned PSMGenerator::getNumPeptides() const {
+  return max(1u, (unsigned)(numPSMs / 2 / peptideMultiplicity));
+}
+
+void PSMGenerator::initFeatureNames() {
+  FeatureNames& names = DataSet::getFeatureNames();
+  for (unsigned f = 0; f < numFeatures; ++f) {
+    names.insertFeature("feature" + boost::lexical_cast<string>(f + 1));
+  }
+  FeatureNames::setNumFeatures(numFeatures);
+}
+
+string PSMGenerator::peptideSequence(unsigned peptide, bool isDecoy) const {
+  const char* aminoAcids = "ACDEFGHILMNPQSTVWY";
+  uint32_t h = hash(peptide + seed * 0x9e3779b9u);
+  unsigned length = 6 + h % 14;
+  string seq;
+  for (unsigned ix = 0; ix < length; ++ix) {
+    h = hash(h + ix);
+    seq += aminoAcids[h % 18];
+  }
+  if (isDecoy) {
+    // reversed decoy, the tryptic c-terminal residue is added below
+    reverse(seq.begin(), seq.end());
+  }
+  seq += ((h >> 8) & 1 ? 'K' : 'R');
+  return seq;
+}
+
+void PSMGenerator::peptideProteins(unsigned peptide, bool isDecoy,
+    vector<string>& proteins) const {
+  string prefix = (isDecoy ? decoyPrefix + "_protein" : string("protein"));
+  unsigned first = peptide % numProteins;
+  proteins.clear();
+  proteins.push_back(prefix + boost::lexical_cast<string>(first));
+  if (hash(peptide ^ 0x5bd1e995u) / 4294967296.0 < sharedPeptideRate) {
+    unsigned second = hash(peptide * 2654435761u) % numProteins;
+    if (second != first) {
+      proteins.push_back(prefix + boost::lexical_cast<string>(second));
+    }
+  }
+}
+
+unsigned PSMGenerator::generatePSM(ParkMillerRandom& rnd, size_t scan,
+    unsigned charge, bool isDecoy, PSMDescription& psm) {
+  bool isCorrect = !isDecoy && (rnd.uniform() >= pi0);
+  unsigned numPeptides = getNumPeptides();
+  unsigned peptide = rnd.next() % numPeptides;
+  if (isCorrect) {
+    // correct PSMs only come from the present half of the proteins
+    unsigned present = max(1u, numProteins / 2);
+    unsigned residue = peptide % numProteins;
+    peptide = peptide - residue + residue % present;
+  }
+  string seq = peptideSequence(peptide, isDecoy);
+  psm.peptide = "K." + seq + ".A";
+  psm.id = (isDecoy ? "decoy_" : "target_") + boost::lexical_cast<string>(scan)
+      + "_" + boost::lexical_cast<string>(charge);
+  psm.scan = scan;
+  psm.charge = charge;
+  psm.calcMass = 18.0106 + 110.0 * seq.size();
+  psm.expMass = psm.calcMass + (isCorrect ? 0.005 : 1.0) * rnd.gaussian();
+  for (unsigned f = 0; f < numFeatures; ++f) {
+    psm.features[f] = rnd.gaussian() + (isCorrect ? separation / (f + 1) : 0.0);
+  }
+  vector<string> proteins;
+  peptideProteins(peptide, isDecoy, proteins);
+  psm.proteinIds.clear();
+  psm.proteinIds.insert(proteins.begin(), proteins.end());
+  return peptide;
+}
+
+void PSMGenerator::writeTab(ostream& os) {
+  initFeatureNames();
+  SetHandler::writeTabHeader(os);
+  ParkMillerRandom rnd(seed);
+  size_t numScans = numPSMs / 2;
+  for (size_t start = 0; start < numScans; start += chunkSize) {
+    DataSet targets, decoys;
+    targets.setLabel(1);
+    decoys.setLabel(-1);
+    for (size_t scan = start; scan < min(numScans, start + chunkSize); ++scan) {
+      unsigned charge = minCharge + rnd.next() % (maxCharge - minCharge + 1);
+      for (int label = 1; label >= -1; label -= 2) {
+        PSMDescription* psm = new PSMDescription();
+        psm->features = new double[numFeatures];
+        generatePSM(rnd, scan, charge, label == -1, *psm);
+        (label == 1 ? targets : decoys).push_back_psm(psm);
+      }
+    }
+    targets.writeTabData(os, "1");
+    decoys.writeTabData(os, "-1");
+  }
+}
+
+void PSMGenerator::writePin(ostream& os) {
+  xercesc::XMLPlatformUtils::Initialize();
+  initFeatureNames();
+
+  string schema_major = boost::lexical_cast<string>(PIN_VERSION_MAJOR);
+  string schema_minor = boost::lexical_cast<string>(PIN_VERSION_MINOR);
+  os << "<?xml version=\"1.0\" encoding=\"UTF-8\"?> \n" +
+      string("<experiment xmlns=\"") + PERCOLATOR_IN_NAMESPACE + "\"" +
+      " xmlns:xsi=\"http://www.w3.org/2001/XMLSchema-instance\"" +
+      " xsi:schemaLocation=\"" + PERCOLATOR_IN_NAMESPACE +
+      " https://github.com/percolator/percolator/raw/pin-" + schema_major +
+      "-" + schema_minor + "/src/xml/percolator_in.xsd\"> \n";
+  os << "\n<enzyme>trypsin</enzyme>\n";
+  os << "\n<process_info>\n  <command_line>psm-generator -n " << numPSMs
+     << " -f " << numFeatures << " -p " << numProteins << " -z " << pi0
+     << " -s " << sharedPeptideRate << " -m " << peptideMultiplicity
+     << " -S " << seed << "</command_line>\n</process_info>\n";
+  {
+    percolatorInNs::featureDescriptions fdes;
+    for (unsigned f = 0; f < numFeatures; ++f) {
+      std::auto_ptr< ::percolatorInNs::featureDescription > f_p(
+          new ::percolatorInNs::featureDescription("feature" + boost::lexical_cast<string>(f + 1)));
+      fdes.featureDescription().push_back(f_p);
+    }
+    serializer ser;
+    ser.start(os);
+    ser.next(PERCOLATOR_IN_NAMESPACE, "featureDescriptions", fdes);
+  }
+
+  serializer ser;
+  ser.start(os);
+  ParkMillerRandom rnd(seed);
+  PSMDescription psm;
+  vector<double> features(numFeatures);
+  psm.features = &features[0];
+  size_t numScans = numPSMs / 2;
+  for (size_t scan = 0; scan < numScans; ++scan) {
+    unsigned charge = minCharge + rnd.next() % (maxCharge - minCharge + 1);
+    ::percolatorInNs::fragSpectrumScan fss(scan);
+    for (int label = 1; label >= -1; label -= 2) {
+      bool isDecoy = (label == -1);
+      generatePSM(rnd, scan, charge, isDecoy, psm);
+      std::auto_ptr< percolatorInNs::features > features_p(new percolatorInNs::features());
+      percolatorInNs::features::feature_sequence& f_seq = features_p->feature();
+      std::copy(features.begin(), features.end(), std::back_inserter(f_seq));
+      std::auto_ptr< percolatorInNs::peptideType > peptide_p(
+          new percolatorInNs::peptideType(psm.getPeptideSequence()));
+      std::auto_ptr< percolatorInNs::peptideSpectrumMatch > psm_p(
+          new percolatorInNs::peptideSpectrumMatch(features_p, peptide_p, psm.id,
+              isDecoy, psm.expMass, psm.calcMass, charge));
+      for (set<string>::const_iterator it = psm.proteinIds.begin();
+          it != psm.proteinIds.end(); ++it) {
+        std::auto_ptr< percolatorInNs::occurence > oc_p(
+            new percolatorInNs::occurence(*it, psm.getFlankN(), psm.getFlankC()));
+        psm_p->occurence().push_back(oc_p);
+      }
+      fss.peptideSpectrumMatch().push_back(psm_p);
+    }
+    ser.next(PERCOLATOR_IN_NAMESPACE, "fragSpectrumScan", fss);
+  }
+  psm.features = NULL;
+
+  os << "</experiment>" << std::endl;
+  xercesc::XMLPlatformUtils::Terminate();
+}
+
+void PSMGenerator::writeQvality(ostream& targets, ostream& decoys) {
+  ParkMillerRandom rnd(seed);
+  PSMDescription psm;
+  vector<double> features(numFeatures);
+  psm.features = &features[0];
+  size_t numScans = numPSMs / 2;
+  for (size_t scan = 0; scan < numScans; ++scan) {
+    unsigned charge = minCharge + rnd.next() % (maxCharge - minCharge + 1);
+    generatePSM(rnd, scan, charge, false, psm);
+    targets << features[0] << endl;
+    generatePSM(rnd, scan, charge, true, psm);
+    decoys << features[0] << endl;
+  }
+  psm.features = NULL;
+}
+
+void PSMGenerator::writeFidoGraph(ostream& os) {
+  // best probability of every target (even) and decoy (odd) peptide,
+  // -1 if the peptide was never observed
+  vector<float> best(2 * (size_t)getNumPeptides(), -1.0f);
+  ParkMillerRandom rnd(seed);
+  PSMDescription psm;
+  vector<double> features(numFeatures);
+  psm.features = &features[0];
+  size_t numScans = numPSMs / 2;
+  for (size_t scan = 0; scan < numScans; ++scan) {
+    unsigned charge = minCharge + rnd.next() % (maxCharge - minCharge + 1);
+    for (int label = 1; label >= -1; label -= 2) {
+      unsigned peptide = generatePSM(rnd, scan, charge, label == -1, psm);
+      size_t ix = 2 * (size_t)peptide + (label == -1 ? 1 : 0);
+      float prob = (float)(1.0 / (1.0 + exp(-2.0 * (features[0] - separation / 2.0))));
+      best[ix] = max(best[ix], prob);
+    }
+  }
+  psm.features = NULL;
+  vector<string> proteins;
+  for (size_t ix = 0; ix < best.size(); ++ix) {
+    if (best[ix] < 0.0f) {
+      continue;
+    }
+    bool isDecoy = (ix % 2 == 1);
+    os << "e " << peptideSequence(ix / 2, isDecoy) << endl;
+    peptideProteins(ix / 2, isDecoy, proteins);
+    for (size_t jx = 0; jx < proteins.size(); ++jx) {
+      os << "r " << proteins[jx] << endl;
+    }
+    os << "p " << best[ix] << endl;
+  }
+}
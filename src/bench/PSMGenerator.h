@@ -0,0 +1,119 @@
+/*******************************************************************************
+ Copyright 2006-2012 Lukas Käll <lukas.kall@scilifelab.se>
+
+ Licensed under the Apache License, Version 2.0 (the "License");
+ you may not use this file except in compliance with the License.
+ You may obtain a copy of the License at
+
+ http://www.apache.org/licenses/LICENSE-2.0
+
+ Unless required by applicable law or agreed to in writing, software
+ distributed under the License is distributed on an "AS IS" BASIS,
+ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ See the License for the specific language governing permissions and
+ limitations under the License.
+
+ *******************************************************************************/
+
+#ifndef PSMGENERATOR_H_
+#define PSMGENERATOR_H_
+
+#include <stdint.h>
+
+#include <string>
+#include <vector>
+#include <iostream>
+#include <fstream>
+#include <cmath>
+#include "PSMDescription.h"
+
+using namespace std;
+
+/** Park-Miller generator, so that the synthetic sets are identical on every
+ *  platform for a given seed **/
+class ParkMillerRandom {
+  public:
+    ParkMillerRandom(uint32_t s = 1) : state(s ? s : 1) {}
+    uint32_t next() {
+      state = (uint32_t)(((uint64_t)state * 279470273) % 4294967291u);
+      return state;
+    }
+    double uniform() {
+      return (next() + 0.5) / 4294967296.0;
+    }
+    double gaussian() {
+      return sqrt(-2.0 * log(uniform())) * cos(2.0 * 3.14159265358979323846 * uniform());
+    }
+  private:
+    uint32_t state;
+};
+
+/**
+ * Generates seeded synthetic PSM sets for scaling tests. Every spectrum gets
+ * one target and one decoy PSM with the same charge. A fraction 1-pi0 of the
+ * target PSMs are correct; their features are shifted and their peptides are
+ * drawn from the present half of the proteins. Peptides are identified by an
+ * index whose sequence and protein(s) are derived from a hash, so that the
+ * sets can be streamed in chunks without holding them in memory. Only the
+ * fido graph keeps a value per peptide, see writeFidoGraph.
+ */
+class PSMGenerator {
+  public:
+    enum OutputFormat {
+      PIN = 0, TAB, QVALITY, FIDO
+    };
+
+    PSMGenerator();
+    virtual ~PSMGenerator();
+    string greeter();
+    bool parseOptions(int argc, char** argv);
+    int run();
+
+    /** writes the set with the tab writer of SetHandler and DataSet **/
+    void writeTab(ostream& os);
+    /** writes the set as pin xml with the percolator_in serializer **/
+    void writePin(ostream& os);
+    /** writes the first feature of targets and decoys as qvality input **/
+    void writeQvality(ostream& targets, ostream& decoys);
+    /** writes the peptide-protein graph in fido format. The best probability
+     *  of every target and decoy peptide is kept until all PSMs are drawn,
+     *  8 bytes per peptide **/
+    void writeFidoGraph(ostream& os);
+
+    void setNumPSMs(size_t n) { numPSMs = n; }
+    void setNumFeatures(unsigned n) { numFeatures = n; }
+    void setNumProteins(unsigned n) { numProteins = n; }
+    void setPi0(double p) { pi0 = p; }
+    void setSharedPeptideRate(double r) { sharedPeptideRate = r; }
+    void setPeptideMultiplicity(double m) { peptideMultiplicity = m; }
+    void setSeed(uint32_t s) { seed = s; }
+    void setDecoyPrefix(const string& prefix) { decoyPrefix = prefix; }
+    /** registers the feature names in DataSet::getFeatureNames() **/
+    void initFeatureNames();
+
+  private:
+    /** fills psm (and its features) for the given spectrum and returns the
+     *  index of its peptide **/
+    unsigned generatePSM(ParkMillerRandom& rnd, size_t scan, unsigned charge,
+                     bool isDecoy, PSMDescription& psm);
+    string peptideSequence(unsigned peptide, bool isDecoy) const;
+    void peptideProteins(unsigned peptide, bool isDecoy, vector<string>& proteins) const;
+    unsigned getNumPeptides() const;
+    static uint32_t hash(uint32_t x);
+
+    size_t numPSMs;
+    unsigned numFeatures;
+    unsigned numProteins;
+    double pi0;
+    double sharedPeptideRate;
+    double peptideMultiplicity;
+    double separation;
+    unsigned minCharge, maxCharge;
+    uint32_t seed;
+    string decoyPrefix;
+    OutputFormat format;
+    string outputFN, decoyOutputFN;
+    const static size_t chunkSize = 100000;
+};
+
+#endif /* PSMGENERATOR_H_ */
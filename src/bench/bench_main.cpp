@@ -0,0 +1,479 @@
+/*******************************************************************************
+ Copyright 2006-2012 Lukas Käll <lukas.kall@scilifelab.se>
+
+ Licensed under the Apache License, Version 2.0 (the "License");
+ you may not use this file except in compliance with the License.
+ You may obtain a copy of the License at
+
+ http://www.apache.org/licenses/LICENSE-2.0
+
+ Unless required by applicable law or agreed to in writing, software
+ distributed under the License is distributed on an "AS IS" BASIS,
+ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ See the License for the specific language governing permissions and
+ limitations under the License.
+
+ *******************************************************************************/
+
+#include <fstream>
+#include <sstream>
+#include <algorithm>
+#include <cmath>
+#include <boost/filesystem.hpp>
+#include <boost/lexical_cast.hpp>
+#include <boost/algorithm/string.hpp>
+#include "Option.h"
+#include "Globals.h"
+#include "Caller.h"
+#include "FeatureNames.h"
+#include "PosteriorEstimator.h"
+#include "GroupPowerBigraph.h"
+#include "Numerical.h"
+#include "ssl.h"
+#include "PSMGenerator.h"
+#include "bench_main.h"
+
+/*******************************************************************************
+ * KERNELS
+ *******************************************************************************/
+
+class TabReaderBenchmark : public BenchmarkCase {
+  public:
+    TabReaderBenchmark(const string& fn) : BenchmarkCase("tab-reader"), fn(fn) {}
+    size_t run() {
+      SetHandler norm, shuff;
+      norm.readTab(fn, 1);
+      shuff.readTab(fn, -1);
+      return norm.getSize() + shuff.getSize();
+    }
+  private:
+    string fn;
+};
+
+class PinReaderBenchmark : public BenchmarkCase {
+  public:
+    PinReaderBenchmark(const string& fn) : BenchmarkCase("pin-reader"), fn(fn) {}
+    size_t run() {
+      Caller caller;
+      const char* args[] = { "percolator", "-s", fn.c_str() };
+      caller.parseOptions(3, const_cast<char**>(args));
+      if (!caller.readFiles()) {
+        throw MyException("Error : could not read pin file " + fn + "\n");
+      }
+      return caller.getSetHandler(Caller::NORMAL)->getSize()
+          + caller.getSetHandler(Caller::SHUFFLED)->getSize();
+    }
+  private:
+    string fn;
+};
+
+class CalcScoresBenchmark : public BenchmarkCase {
+  public:
+    CalcScoresBenchmark(Scores& s, const vector<double>& w, unsigned seed) :
+      BenchmarkCase("calcScores"), scores(s), w(w), rnd(seed) {}
+    void setUp() {
+      // start every repetition from an unsorted list
+      for (size_t ix = scores.scores.size(); ix > 1; --ix) {
+        swap(scores.scores[ix - 1], scores.scores[rnd.next() % ix]);
+      }
+    }
+    size_t run() {
+      scores.calcScores(w);
+      return scores.size();
+    }
+  private:
+    Scores& scores;
+    vector<double> w;
+    ParkMillerRandom rnd;
+};
+
+class CalcQBenchmark : public BenchmarkCase {
+  public:
+    CalcQBenchmark(Scores& s) : BenchmarkCase("calcQ"), scores(s) {}
+    size_t run() {
+      scores.calcQ();
+      return scores.size();
+    }
+  private:
+    Scores& scores;
+};
+
+class SvmBenchmark : public BenchmarkCase {
+  public:
+    SvmBenchmark(Scores& s) : BenchmarkCase("L2_SVM_MFN"),
+      svmInput(s.size(), FeatureNames::getNumFeatures() + 1) {
+      s.generateNegativeTrainingSet(svmInput, 1.0);
+      s.generatePositiveTrainingSet(svmInput, 0.01, 1.0);
+      svmInput.setCost(1.0, 1.0 * s.targetDecoySizeRatio);
+      opt.lambda = 1.0;
+      opt.lambda_u = 1.0;
+      opt.epsilon = EPSILON;
+      opt.cgitermax = CGITERMAX;
+      opt.mfnitermax = MFNITERMAX;
+      weights.d = FeatureNames::getNumFeatures() + 1;
+      weights.vec = new double[weights.d];
+      outputs.d = svmInput.positives + svmInput.negatives;
+      outputs.vec = new double[outputs.d];
+    }
+    ~SvmBenchmark() {
+      delete[] weights.vec;
+      delete[] outputs.vec;
+    }
+    void setUp() {
+      fill(weights.vec, weights.vec + weights.d, 0.0);
+      fill(outputs.vec, outputs.vec + outputs.d, 0.0);
+    }
+    size_t run() {
+      L2_SVM_MFN(svmInput, &opt, &weights, &outputs);
+      return svmInput.m;
+    }
+  private:
+    AlgIn svmInput;
+    options opt;
+    vector_double weights, outputs;
+};
+
+class Pi0Benchmark : public BenchmarkCase {
+  public:
+    Pi0Benchmark(Scores& s) : BenchmarkCase("estimatePi0") {
+      transform(s.begin(), s.end(), back_inserter(combined),
+          mem_fun_ref(&ScoreHolder::toPair));
+    }
+    size_t run() {
+      vector<double> p;
+      PosteriorEstimator::getPValues(combined, p);
+      PosteriorEstimator::estimatePi0(p);
+      return combined.size();
+    }
+  private:
+    vector<pair<double, bool> > combined;
+};
+
+class PepBenchmark : public BenchmarkCase {
+  public:
+    PepBenchmark(Scores& s) : BenchmarkCase("estimatePEP"), pi0(s.pi0) {
+      transform(s.begin(), s.end(), back_inserter(combined),
+          mem_fun_ref(&ScoreHolder::toPair));
+    }
+    size_t run() {
+      vector<double> peps;
+      PosteriorEstimator::estimatePEP(combined, pi0, peps);
+      return combined.size();
+    }
+  private:
+    vector<pair<double, bool> > combined;
+    double pi0;
+};
+
+class WeedOutBenchmark : public BenchmarkCase {
+  public:
+    WeedOutBenchmark(Scores& s) : BenchmarkCase("weedOutRedundant"), full(s) {}
+    void setUp() {
+      work = full;
+    }
+    size_t run() {
+      work.weedOutRedundant(false);
+      return full.size();
+    }
+    void tearDown() {
+      work = Scores();
+    }
+  private:
+    Scores& full;
+    Scores work;
+};
+
+class FidoBenchmark : public BenchmarkCase {
+  public:
+    FidoBenchmark(const string& graph) : BenchmarkCase("fido-getProteinProbs"),
+      graph(0.1, 0.01, 0.5) {
+      istringstream is(graph);
+      this->graph.setMultipleLabeledPeptides(false);
+      this->graph.read(is);
+      vector<vector<string> > names;
+      vector<double> probs;
+      this->graph.getProteinProbs();
+      this->graph.getProteinProbsAndNames(names, probs);
+      numProteins = probs.size();
+    }
+    size_t run() {
+      graph.getProteinProbs();
+      return numProteins;
+    }
+  private:
+    GroupPowerBigraph graph;
+    size_t numProteins;
+};
+
+class LogSpaceBenchmark : public BenchmarkCase {
+  public:
+    // batched runs the Numerical kernels, otherwise the same exp2, log2
+    // and logAdd calls are made one element at a time as the baseline
+    LogSpaceBenchmark(bool batched, size_t n, unsigned seed) :
+      BenchmarkCase(batched ? "fido-logspace" : "fido-logspace-scalar"),
+      batched(batched), x(n), y(n) {
+      ParkMillerRandom rnd(seed);
+      for (size_t ix = 0; ix < n; ++ix) {
+        x[ix] = -50.0 * (rnd.next() % 1000000) / 1000000.0;
+      }
+    }
+    size_t run() {
+      int n = (int)x.size();
+      double sum = 0.0;
+      if (batched) {
+        Numerical::exp2Batch(&x[0], &y[0], n);
+        Numerical::log2Batch(&y[0], &y[0], n);
+        sum = Numerical::logAddBatch(&y[0], n);
+      } else {
+        for (int ix = 0; ix < n; ++ix) {
+          y[ix] = ::log2(::exp2(x[ix]));
+        }
+        sum = y[0];
+        for (int ix = 1; ix < n; ++ix) {
+          sum = Numerical::logAdd(sum, y[ix]);
+        }
+      }
+      // keeps the result alive
+      return (sum > 0.0 ? 2 * x.size() : x.size());
+    }
+  private:
+    bool batched;
+    vector<double> x, y;
+};
+
+/*******************************************************************************
+ * DRIVER
+ *******************************************************************************/
+
+PercolatorBench::PercolatorBench() :
+  numPSMs(100000), numFeatures(10), numProteins(2000), repetitions(10),
+  warmup(1), seed(1), pi0(0.5), pinFN(""), tabFN(""), outputFN("") {
+}
+
+PercolatorBench::~PercolatorBench() {
+}
+
+string PercolatorBench::greeter() {
+  ostringstream oss;
+  oss << "percolator-bench version " << VERSION << ", ";
+  oss << "Build Date " << __DATE__ << " " << __TIME__ << endl;
+  oss << "Benchmarks the computational kernels of percolator, qvality and fido" << endl;
+  return oss.str();
+}
+
+bool PercolatorBench::parseOptions(int argc, char** argv) {
+  ostringstream intro;
+  intro << greeter() << endl;
+  intro << "Usage:" << endl;
+  intro << "   percolator-bench [options]" << endl;
+  intro << "Kernels: tab-reader, pin-reader, calcScores, calcQ, L2_SVM_MFN," << endl;
+  intro << "         estimatePi0, estimatePEP, weedOutRedundant, fido-getProteinProbs," << endl;
+  intro << "         fido-logspace, fido-logspace-scalar" << endl;
+  CommandLineParser cmd(intro.str());
+  cmd.defineOption("v",
+      "verbose",
+      "Set verbosity of output: 0=no processing info, 5=all, default is 2",
+      "level");
+  cmd.defineOption("n",
+      "psms",
+      "Number of synthetic PSMs, targets and decoys together. Default is 100000.",
+      "value");
+  cmd.defineOption("f",
+      "features",
+      "Number of features of the synthetic PSMs. Default is 10.",
+      "value");
+  cmd.defineOption("p",
+      "proteins",
+      "Number of target proteins of the synthetic PSMs. Default is 2000.",
+      "value");
+  cmd.defineOption("z",
+      "pi0",
+      "Fraction of incorrect target PSMs in the synthetic set. Default is 0.5.",
+      "value");
+  cmd.defineOption("r",
+      "repetitions",
+      "Number of timed repetitions of each kernel. Default is 10.",
+      "value");
+  cmd.defineOption("w",
+      "warmup",
+      "Number of untimed warm up runs of each kernel. Default is 1.",
+      "value");
+  cmd.defineOption("S",
+      "seed",
+      "Seed of the random number generator used to create the synthetic set. Default is 1.",
+      "value");
+  cmd.defineOption("k",
+      "kernels",
+      "Comma separated list of the kernels to run. Default is all of them.",
+      "list");
+  cmd.defineOption("i",
+      "pin",
+      "pin file used by the pin-reader kernel, which is skipped if not given. It is read \
+       before the synthetic set is created, so its number of features overrides -f.",
+      "filename");
+  cmd.defineOption("t",
+      "tab-file",
+      "Keep the synthetic tab delimited set in this file instead of a temporary file.",
+      "filename");
+  cmd.defineOption("o",
+      "output",
+      "Write the JSON report to this file instead of stdout.",
+      "filename");
+  cmd.parseArgs(argc, argv);
+
+  if (cmd.optionSet("v")) {
+    Globals::getInstance()->setVerbose(cmd.getInt("v", 0, 10));
+  }
+  if (cmd.optionSet("n")) numPSMs = cmd.getInt("n", 100, 1000000000);
+  if (cmd.optionSet("f")) numFeatures = cmd.getInt("f", 1, 1000);
+  if (cmd.optionSet("p")) numProteins = cmd.getInt("p", 1, 100000000);
+  if (cmd.optionSet("z")) pi0 = cmd.getDouble("z", 0.0, 1.0);
+  if (cmd.optionSet("r")) repetitions = cmd.getInt("r", 1, 100000);
+  if (cmd.optionSet("w")) warmup = cmd.getInt("w", 0, 100000);
+  if (cmd.optionSet("S")) seed = cmd.getInt("S", 1, 20000);
+  if (cmd.optionSet("i")) pinFN = cmd.options["i"];
+  if (cmd.optionSet("t")) tabFN = cmd.options["t"];
+  if (cmd.optionSet("o")) outputFN = cmd.options["o"];
+  if (cmd.optionSet("k")) {
+    vector<string> names;
+    boost::split(names, cmd.options["k"], boost::is_any_of(","));
+    kernels.insert(names.begin(), names.end());
+  }
+  return true;
+}
+
+bool PercolatorBench::isSelected(const string& kernel) {
+  return kernels.empty() || kernels.count(kernel) > 0;
+}
+
+void PercolatorBench::writeSyntheticTab(const string& fn) {
+  ofstream out(fn.c_str(), ios::out);
+  if (!out) {
+    throw MyException("Error : Can not open file " + fn + "\n");
+  }
+  PSMGenerator generator;
+  generator.setNumPSMs(numPSMs);
+  generator.setNumFeatures(numFeatures);
+  generator.setNumProteins(numProteins);
+  generator.setPi0(pi0);
+  generator.setSeed(seed);
+  generator.writeTab(out);
+  out.close();
+}
+
+void PercolatorBench::writeFidoGraph(ostream& os) {
+  // one entry per peptide with the probability of its best PSM
+  map<string, pair<set<string>, double> > peptides;
+  vector<ScoreHolder>::iterator it = fullset.begin();
+  for (; it != fullset.end(); ++it) {
+    pair<set<string>, double>& entry = peptides[it->pPSM->getPeptideSequence()];
+    entry.first.insert(it->pPSM->proteinIds.begin(), it->pPSM->proteinIds.end());
+    entry.second = max(entry.second, 1.0 - it->pPSM->pep);
+  }
+  map<string, pair<set<string>, double> >::const_iterator pep = peptides.begin();
+  for (; pep != peptides.end(); ++pep) {
+    os << "e " << pep->first << endl;
+    set<string>::const_iterator pid = pep->second.first.begin();
+    for (; pid != pep->second.first.end(); ++pid) {
+      os << "r " << *pid << endl;
+    }
+    os << "p " << pep->second.second << endl;
+  }
+}
+
+int PercolatorBench::run() {
+  BenchmarkRunner runner(repetitions, warmup);
+  runner.setParameter("psms", boost::lexical_cast<string>(numPSMs));
+  runner.setParameter("proteins", boost::lexical_cast<string>(numProteins));
+  runner.setParameter("pi0", boost::lexical_cast<string>(pi0));
+  runner.setParameter("seed", boost::lexical_cast<string>(seed));
+
+  // the pin reader sets the global number of features so it goes first
+  if (pinFN.size() > 0 && isSelected("pin-reader")) {
+    runner.setParameter("pin", pinFN);
+    runner.add(new PinReaderBenchmark(pinFN));
+    runner.runAll();
+    numFeatures = FeatureNames::getNumFeatures();
+  }
+  runner.setParameter("features", boost::lexical_cast<string>(numFeatures));
+
+  bool removeTab = false;
+  if (tabFN.empty()) {
+    boost::filesystem::path ph = boost::filesystem::unique_path("percolator-bench-%%%%-%%%%.tab");
+    tabFN = (boost::filesystem::temp_directory_path() / ph).string();
+    removeTab = true;
+  }
+  if (VERB > 1) {
+    cerr << "Writing " << numPSMs << " synthetic PSMs to " << tabFN << endl;
+  }
+  writeSyntheticTab(tabFN);
+
+  // build the fixture used by all in-memory kernels
+  normal.readTab(tabFN, 1);
+  shuffled.readTab(tabFN, -1);
+  fullset.fillFeatures(normal, shuffled, false);
+  vector<double> w(FeatureNames::getNumFeatures() + 1, 0.0);
+  for (size_t ix = 0; ix < FeatureNames::getNumFeatures(); ++ix) {
+    w[ix] = 1.0 / (ix + 1);
+  }
+  fullset.calcScores(w);
+  fullset.estimatePi0();
+  fullset.calcPep();
+
+  if (isSelected("tab-reader")) runner.add(new TabReaderBenchmark(tabFN));
+  if (isSelected("calcScores")) runner.add(new CalcScoresBenchmark(fullset, w, seed));
+  runner.runAll();
+  // calcQ, the svm and the posterior estimation all need sorted scores
+  fullset.calcScores(w);
+  if (isSelected("calcQ")) runner.add(new CalcQBenchmark(fullset));
+  if (isSelected("L2_SVM_MFN")) runner.add(new SvmBenchmark(fullset));
+  if (isSelected("estimatePi0")) runner.add(new Pi0Benchmark(fullset));
+  if (isSelected("estimatePEP")) runner.add(new PepBenchmark(fullset));
+  if (isSelected("weedOutRedundant")) runner.add(new WeedOutBenchmark(fullset));
+  if (isSelected("fido-getProteinProbs")) {
+    ostringstream graph;
+    writeFidoGraph(graph);
+    runner.add(new FidoBenchmark(graph.str()));
+  }
+  if (isSelected("fido-logspace")) runner.add(new LogSpaceBenchmark(true, numPSMs, seed));
+  if (isSelected("fido-logspace-scalar")) runner.add(new LogSpaceBenchmark(false, numPSMs, seed));
+  runner.runAll();
+
+  if (removeTab) {
+    boost::filesystem::remove(tabFN);
+  }
+
+  if (outputFN.size() > 0) {
+    ofstream out(outputFN.c_str(), ios::out);
+    runner.writeJSON(out);
+    out.close();
+  } else {
+    runner.writeJSON(cout);
+  }
+  return true;
+}
+
+int main(int argc, char** argv)
+{
+  PercolatorBench* pCaller = new PercolatorBench();
+  int retVal = -1;
+  try
+  {
+    if (pCaller->parseOptions(argc, argv)) {
+      retVal = pCaller->run() ? 0 : -1;
+    }
+  }
+  catch (const std::exception& e)
+  {
+    std::cerr << e.what() << endl;
+    retVal = -1;
+  }
+  catch(...)
+  {
+    std::cerr << "Unknown exception, contact the developer.." << std::endl;
+    retVal = -1;
+  }
+  delete pCaller;
+  Globals::clean();
+  return retVal;
+}
@@ -0,0 +1,70 @@
+/*******************************************************************************
+ Copyright 2006-2012 Lukas Käll <lukas.kall@scilifelab.se>
+
+ Licensed under the Apache License, Version 2.0 (the "License");
+ you may not use this file except in compliance with the License.
+ You may obtain a copy of the License at
+
+ http://www.apache.org/licenses/LICENSE-2.0
+
+ Unless required by applicable law or agreed to in writing, software
+ distributed under the License is distributed on an "AS IS" BASIS,
+ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ See the License for the specific language governing permissions and
+ limitations under the License.
+
+ *******************************************************************************/
+
+#ifndef BENCH_MAIN_H_
+#define BENCH_MAIN_H_
+
+#include <string>
+#include <vector>
+#include <set>
+#include "SetHandler.h"
+#include "Scores.h"
+#include "Benchmark.h"
+
+using namespace std;
+
+/**
+ * percolator-bench, times the hot kernels of percolator, qvality and fido on
+ * a seeded synthetic data set of configurable size and reports the results
+ * as JSON so that they can be compared between releases.
+ */
+class PercolatorBench {
+
+  public:
+
+    PercolatorBench();
+    virtual ~PercolatorBench();
+    string greeter();
+    bool parseOptions(int argc, char** argv);
+    int run();
+
+  private:
+
+    /** writes a seeded synthetic tab delimited input file **/
+    void writeSyntheticTab(const string& fn);
+    /** writes the peptide-protein graph of the synthetic set in fido format **/
+    void writeFidoGraph(ostream& os);
+    bool isSelected(const string& kernel);
+
+    unsigned numPSMs;
+    unsigned numFeatures;
+    unsigned numProteins;
+    unsigned repetitions;
+    unsigned warmup;
+    unsigned seed;
+    double pi0;
+    string pinFN;
+    string tabFN;
+    string outputFN;
+    set<string> kernels;
+    SetHandler normal, shuffled;
+    Scores fullset;
+};
+
+int main(int argc, char **argv);
+
+#endif /* BENCH_MAIN_H_ */
@@ -1,32 +1,186 @@
 #include "FragSpectrumScanDatabase.h"
+#include <algorithm>
+#include <limits>
+#include <cmath>
 //#include <MSToolkitTypes.h>
  
 
 FragSpectrumScanDatabase::FragSpectrumScanDatabase(string id_par) :
-    scan2rt(0) 
+    scan2rt(0), memoryUsage(0), pendingMemory(0), reportedMemory(0)
 {
   if(id_par.empty()) id = "no_id"; else id = id_par;
 }
 
+FragSpectrumScanDatabase::~FragSpectrumScanDatabase()
+{
+  PsmBuffer::iterator it;
+  for(it = pendingPsms.begin(); it != pendingPsms.end(); it++)
+  {
+    for(size_t i = 0; i < it->second.size(); i++)
+      delete it->second[i];
+  }
+  if(reportedMemory > 0)
+    Globals::getInstance()->getProfiler()->releaseMemory("FragSpectrumScanDatabase", reportedMemory);
+}
+
+void FragSpectrumScanDatabase::setMemoryUsage(size_t bytes)
+{
+  memoryUsage = bytes;
+  reportMemory(bytes == 0);
+}
+
+void FragSpectrumScanDatabase::reportMemory(bool force)
+{
+  // the profiler takes a lock that is shared by all threads, so it is only
+  // told once the usage has moved by a chunk
+  size_t bytes = memoryUsage + pendingMemory;
+  if(!force && max(bytes, reportedMemory) - min(bytes, reportedMemory) < memoryReportChunk)
+    return;
+  Profiler* prof = Globals::getInstance()->getProfiler();
+  size_t old = reportedMemory;
+  reportedMemory = bytes;
+  if(bytes > old)
+    prof->allocateMemory("FragSpectrumScanDatabase", bytes - old);
+  else
+    prof->releaseMemory("FragSpectrumScanDatabase", old - bytes);
+}
+
+size_t FragSpectrumScanDatabase::psmMemory(const percolatorInNs::peptideSpectrumMatch & psm)
+{
+  return sizeof(percolatorInNs::peptideSpectrumMatch)
+      + psm.features().feature().size() * sizeof(percolatorInNs::features::feature_type)
+      + psm.occurence().size() * sizeof(percolatorInNs::occurence);
+}
+
 void FragSpectrumScanDatabase::savePsm( unsigned int scanNr,
     std::auto_ptr< percolatorInNs::peptideSpectrumMatch > psm_p ) 
 {
-  std::auto_ptr< ::percolatorInNs::fragSpectrumScan>  fss = getFSS( scanNr );
-  // if FragSpectrumScan does not yet exist, create it
-  if ( ! fss.get() ) {
-    std::auto_ptr< ::percolatorInNs::fragSpectrumScan>
-    fs_p( new ::percolatorInNs::fragSpectrumScan(scanNr));
-    fss = fs_p;
-  }
-  // add the psm to the FragSpectrumScan
-  fss->peptideSpectrumMatch().push_back(psm_p);
-  putFSS( *fss );
+  size_t bytes = psmMemory(*psm_p) + sizeof(void*);
+  pendingPsms[scanNr].push_back(psm_p.release());
+  pendingMemory += bytes;
+  reportMemory();
+  
+  Profiler* prof = Globals::getInstance()->getProfiler();
+  size_t maxMemory = maxPendingMemory;
+  if(prof->getMaxMemory() > 0)
+    maxMemory = std::min(maxMemory, prof->getMaxMemory() / 4);
+  if(pendingMemory > maxMemory)
+    flushPsms();
   return;
 }
 
+void FragSpectrumScanDatabase::flushPsms()
+{
+  if(VERB > 3 && !pendingPsms.empty())
+    cerr << "Storing the psms of " << pendingPsms.size() << " scans in " << id << endl;
+  PsmBuffer::iterator it;
+  for(it = pendingPsms.begin(); it != pendingPsms.end(); it++)
+  {
+    std::auto_ptr< ::percolatorInNs::fragSpectrumScan>  fss = getFSS( it->first );
+    // if FragSpectrumScan does not yet exist, create it
+    if ( ! fss.get() ) {
+      std::auto_ptr< ::percolatorInNs::fragSpectrumScan>
+      fs_p( new ::percolatorInNs::fragSpectrumScan(it->first));
+      fss = fs_p;
+    }
+    addPendingPsms( it->second, *fss );
+    if(scan2rt) storeRetentionTime( *fss );
+    putFSS( *fss );
+  }
+  clearPendingPsms();
+}
+
+void FragSpectrumScanDatabase::addPendingPsms(std::vector<peptideSpectrumMatch*> & psms,
+    fragSpectrumScan & fss)
+{
+  // add the psms to the FragSpectrumScan, which takes over their ownership
+  for(size_t i = 0; i < psms.size(); i++)
+  {
+    std::auto_ptr< percolatorInNs::peptideSpectrumMatch > psm_p(psms[i]);
+    psms[i] = 0;
+    fss.peptideSpectrumMatch().push_back(psm_p);
+  }
+}
+
+void FragSpectrumScanDatabase::mergeScans(fragSpectrumScan & fss, const fragSpectrumScan & part)
+{
+  fragSpectrumScan::peptideSpectrumMatch_const_iterator psm;
+  for(psm = part.peptideSpectrumMatch().begin(); psm != part.peptideSpectrumMatch().end(); ++psm)
+  {
+    fss.peptideSpectrumMatch().push_back(*psm);
+  }
+}
+
+void FragSpectrumScanDatabase::clearPendingPsms()
+{
+  pendingPsms.clear();
+  pendingMemory = 0;
+  reportMemory();
+}
+
 bool FragSpectrumScanDatabase::initRTime(map<int, vector<double> >* scan2rt_par) {
   // add pointer to retention times table (if any)
   scan2rt=scan2rt_par;
+  return true;
+}
+
+void FragSpectrumScanDatabase::storeRetentionTime(fragSpectrumScan & fss)
+{
+  map<int, vector<double> >::const_iterator it = scan2rt->find(fss.scanNumber());
+  if(it == scan2rt->end()) return;
+  // related retention times
+  const vector<double>* rTimes = &(it->second);
+  fragSpectrumScan::peptideSpectrumMatch_sequence& psmSeq = fss.peptideSpectrumMatch();
+  // retention time to be stored
+  double storeMe = 0;
+  // if rTimes only contains one element
+  if(rTimes->size()==1)
+  {
+    // take that as retention time
+    storeMe = rTimes->at(0);
+  }
+  else
+  {
+    // else, take retention time of psm that has observed mass closest to
+    // theoretical mass (smallest massDiff)
+    double massDiff = std::numeric_limits<double>::max(); // + infinity
+    for (fragSpectrumScan::peptideSpectrumMatch_iterator psmIter_i = psmSeq.begin(); psmIter_i != psmSeq.end(); ++psmIter_i)
+    {
+      // skip decoy
+      if(psmIter_i->isDecoy() != true)
+      {
+        double cm = psmIter_i->calculatedMass();
+        double em = psmIter_i->experimentalMass();
+        // if a psm with observed mass closer to theoretical mass is found
+        if(abs(cm-em) < massDiff)
+        {
+          // update massDiff
+          massDiff = abs(cm-em);
+          // Loop over alternatives EZ-lines, choose the one with the smallest mass difference
+          double altMassDiff = std::numeric_limits<double>::max();  // + infinity
+          for(vector<double>::const_iterator r = rTimes->begin(); r<rTimes->end(); r=r+2)  // Loops over the EZ-line mh values (rounded to one or two decimals...)
+          {
+            double rrr = *r;  //mass+h
+            double exm = psmIter_i->experimentalMass();  //actually masstocharge
+            //FIXME: as rrr is m+h and exm is m/z, this ugly fix loops through many charges
+            double rrr_mz;
+            for(int charge = 1; charge<7; charge++) {
+              rrr_mz = (rrr + (charge-1)*1.007276466) / charge;
+              if(abs(rrr_mz-exm) < altMassDiff) {
+                altMassDiff = abs(rrr_mz-exm);
+                storeMe = *(r+1);
+              }
+            }
+          }
+        }
+      }
+    }
+  }
+  // store retention time for all psms in fss
+  for (fragSpectrumScan::peptideSpectrumMatch_iterator psmIter = psmSeq.begin(); psmIter != psmSeq.end(); ++psmIter)
+  {
+    psmIter->observedTime().set(storeMe);
+  }
 }
 
 
@@ -27,7 +27,7 @@
 #include <string>
 #include <iostream>
 #include "Globals.h"
-#include "serializer.hxx"
+#include "PinWriter.h"
 #include <xercesc/util/PlatformUtils.hpp>
 #include <xercesc/dom/DOM.hpp>
 #include <xsd/cxx/xml/string.hxx>
@@ -47,7 +47,6 @@
 
 using namespace std;
 using namespace percolatorInNs;
-class serializer;
 
 struct underflow_info
 {
@@ -68,11 +67,18 @@ class FragSpectrumScanDatabase {
     
     FragSpectrumScanDatabase(string id=0);
     
-    ~FragSpectrumScanDatabase(){};
+    virtual ~FragSpectrumScanDatabase();
     
+    /** the retention times are set on the psms of every scan when it is stored **/
     bool initRTime(map<int, vector<double> >* scan2rt_par);
     
-    void savePsm(unsigned int scanNr, auto_ptr<peptideSpectrumMatch> psm_p );
+    /** buffers the psm for its scan, the scans are only read and written
+     *  by flushPsms or when the buffer grows too large **/
+    virtual void savePsm(unsigned int scanNr, auto_ptr<peptideSpectrumMatch> psm_p );
+    
+    /** adds the buffered psms to their scans, every scan is read and
+     *  written once. Has to be called before getFSS or print **/
+    virtual void flushPsms();
     
     virtual std::string toString() = 0;
     
@@ -84,15 +90,42 @@ class FragSpectrumScanDatabase {
     
     virtual auto_ptr<fragSpectrumScan> deserializeFSSfromBinary(char* value,int valueSize) = 0;
     
-    virtual void print(serializer & ser ) = 0;
+    virtual void print(PinWriter & writer ) = 0;
     
     virtual void terminte() = 0;
     
     std::string id;
   
   protected:
+    /** sets the bytes held in memory by this database in the accounting of
+     *  the FragSpectrumScanDatabase subsystem **/
+    void setMemoryUsage(size_t bytes);
+    /** passes the change of memoryUsage and pendingMemory on to the profiler
+     *  once it exceeds memoryReportChunk, or always if force is set **/
+    void reportMemory(bool force = false);
+    /** rough size of a psm in memory, the features and occurences dominate **/
+    static size_t psmMemory(const peptideSpectrumMatch & psm);
+    /** sets the retention time of the scan on all its psms, if there is one **/
+    void storeRetentionTime(fragSpectrumScan & fss);
+    /** moves the buffered psms of a scan to the scan **/
+    void addPendingPsms(std::vector<peptideSpectrumMatch*> & psms, fragSpectrumScan & fss);
+    /** empties the buffer once all its psms have been moved **/
+    void clearPendingPsms();
+    /** appends the psms of a part of the scan that was stored separately **/
+    static void mergeScans(fragSpectrumScan & fss, const fragSpectrumScan & part);
     // pointer to retention times
     map<int, vector<double> >* scan2rt;
+    size_t memoryUsage;
+    // psms waiting to be added to their scans, in the order they were saved
+    typedef std::map<unsigned int, std::vector<peptideSpectrumMatch*> > PsmBuffer;
+    PsmBuffer pendingPsms;
+    size_t pendingMemory;
+    // the buffer is flushed when it holds more than this, 64 MB or a
+    // quarter of the --max-memory limit if that is smaller
+    static const size_t maxPendingMemory = 64 * 1048576;
+    // the part of the usage that the profiler has been told about
+    size_t reportedMemory;
+    static const size_t memoryReportChunk = 1048576;
     
     
 };
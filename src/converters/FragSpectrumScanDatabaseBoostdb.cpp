@@ -32,6 +32,7 @@ void FragSpectrumScanDatabaseBoostdb::terminte()
     delete bdb;
   }
   bdb = 0;
+  setMemoryUsage(0);
 }
 
 std::auto_ptr< ::percolatorInNs::fragSpectrumScan> FragSpectrumScanDatabaseBoostdb::getFSS( unsigned int scanNr ) 
@@ -48,7 +49,7 @@ std::auto_ptr< ::percolatorInNs::fragSpectrumScan> FragSpectrumScanDatabaseBoost
   return ret;      
 }
 
-void FragSpectrumScanDatabaseBoostdb::print(serializer & ser) 
+void FragSpectrumScanDatabaseBoostdb::print(PinWriter & writer) 
 {
 
   mapdb::const_iterator it;
@@ -58,7 +59,7 @@ void FragSpectrumScanDatabaseBoostdb::print(serializer & ser)
     binary_iarchive ia (istr);
     xml_schema::istream<binary_iarchive> is (ia);
     std::auto_ptr< ::percolatorInNs::fragSpectrumScan> fss (new ::percolatorInNs::fragSpectrumScan (is));
-    ser.next ( PERCOLATOR_IN_NAMESPACE, "fragSpectrumScan", *fss);
+    writer.write(*fss);
   }
 
 }
@@ -71,6 +72,16 @@ void FragSpectrumScanDatabaseBoostdb::putFSS( ::percolatorInNs::fragSpectrumScan
   os << fss;
   ostr.flush();
   ::percolatorInNs::fragSpectrumScan::scanNumber_type key = fss.scanNumber();
-  (*bdb)[key] = ostr.str();
+  size_t bytes = memoryUsage;
+  mapdb::iterator it = bdb->find(key);
+  if(it == bdb->end())
+  {
+    it = bdb->insert(mapdb::value_type(key, std::string())).first;
+    bytes += sizeof(mapdb::value_type) + 4 * sizeof(void*);
+  }
+  bytes -= it->second.capacity();
+  it->second = ostr.str();
+  bytes += it->second.capacity();
+  setMemoryUsage(bytes);
   ostr.str(""); // reset the string
 }
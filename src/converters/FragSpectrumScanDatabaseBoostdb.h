@@ -43,7 +43,7 @@ public:
   
   virtual std::auto_ptr< ::percolatorInNs::fragSpectrumScan> getFSS( unsigned int scanNr );
   
-  virtual void print(serializer & ser);
+  virtual void print(PinWriter & writer);
   
   virtual void putFSS( ::percolatorInNs::fragSpectrumScan & fss );
   
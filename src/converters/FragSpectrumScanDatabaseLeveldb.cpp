@@ -14,6 +14,8 @@ typedef  void (*xdrrec_create_p) (
 FragSpectrumScanDatabaseLeveldb::FragSpectrumScanDatabaseLeveldb(std::string id):FragSpectrumScanDatabase(id)
 {
   bdb = 0;
+  batchSize = 0;
+  run = 0;
   xdrrec_create_p xdrrec_create_ = reinterpret_cast<xdrrec_create_p> (::xdrrec_create);
   xdrrec_create_ (&xdr, 0, 0, reinterpret_cast<char*> (&buf), 0, &overflow);
   xdr.x_op = XDR_ENCODE;
@@ -39,11 +41,16 @@ bool FragSpectrumScanDatabaseLeveldb::init(std::string fileName)
   options.max_open_files = 100;
   options.write_buffer_size = 4194304*2; //8 MB
   options.block_size = 4096*4; //16K
+  // the database is temporary and read once, compressing the blocks is not worth it
+  options.compression = leveldb::kNoCompression;
   leveldb::Status status = leveldb::DB::Open(options, fileName.c_str(), &bdb);
   if (!status.ok()){ 
     std::cerr << status.ToString() << endl;
   }
   bool ret = status.ok();
+  // the memtable of the database and the batch that is being written are
+  // the parts that stay in memory
+  if(ret) setMemoryUsage(2 * options.write_buffer_size);
   return ret;
 }
 
@@ -51,6 +58,7 @@ void FragSpectrumScanDatabaseLeveldb::terminte()
 {
   if(bdb) delete(bdb);
   bdb = 0;
+  setMemoryUsage(0);
 }
 
 std::auto_ptr< ::percolatorInNs::fragSpectrumScan> FragSpectrumScanDatabaseLeveldb::deserializeFSSfromBinary( char * value, int valueSize ) 
@@ -83,31 +91,65 @@ std::auto_ptr< ::percolatorInNs::fragSpectrumScan> FragSpectrumScanDatabaseLevel
   return fss;
 }
 
+std::string FragSpectrumScanDatabaseLeveldb::scanKey(unsigned int scanNr, unsigned int run)
+{
+  char key[8];
+  for(int i = 0; i < 4; i++)
+  {
+    key[i] = (char)((scanNr >> (24 - 8 * i)) & 0xff);
+    key[4 + i] = (char)((run >> (24 - 8 * i)) & 0xff);
+  }
+  return std::string(key, sizeof(key));
+}
+
 std::auto_ptr< ::percolatorInNs::fragSpectrumScan> FragSpectrumScanDatabaseLeveldb::getFSS( unsigned int scanNr ) 
 {
   assert(bdb);
-  std::string skey = boost::lexical_cast<std::string>(scanNr);
-  leveldb::Slice s1(skey);
+  writeBatch();
+  // the scan is merged from all the runs it was written in
+  std::string prefix = scanKey(scanNr, 0).substr(0, 4);
+  leveldb::Slice s1(prefix);
+  std::auto_ptr< ::percolatorInNs::fragSpectrumScan> ret;
   leveldb::Iterator* itr = bdb->NewIterator(leveldb::ReadOptions());
-  itr->Seek(s1);
-  if(!itr->Valid() || s1 != itr->key()){
-    delete itr;
-    return std::auto_ptr< ::percolatorInNs::fragSpectrumScan> (NULL);
+  for(itr->Seek(s1); itr->Valid() && itr->key().starts_with(s1); itr->Next())
+  {
+    char *retvalue = const_cast<char*>(itr->value().data());
+    std::auto_ptr< ::percolatorInNs::fragSpectrumScan> part(deserializeFSSfromBinary(retvalue,itr->value().size()));
+    if(ret.get()) mergeScans(*ret, *part);
+    else ret = part;
   }
-  char *retvalue = const_cast<char*>(itr->value().data());
-  std::auto_ptr< ::percolatorInNs::fragSpectrumScan> ret(deserializeFSSfromBinary(retvalue,itr->value().size()));
   delete itr;
   return ret;
 }
 
-void FragSpectrumScanDatabaseLeveldb::print(serializer & ser) 
+void FragSpectrumScanDatabaseLeveldb::print(PinWriter & writer) 
 {
   assert(bdb);
-  leveldb::Iterator* it = bdb->NewIterator(leveldb::ReadOptions());
+  writeBatch();
+  // one sequential pass over the database, the runs of a scan are next to each other
+  leveldb::ReadOptions read_options;
+  read_options.fill_cache = false;
+  leveldb::Iterator* it = bdb->NewIterator(read_options);
+  std::auto_ptr< ::percolatorInNs::fragSpectrumScan> fss;
   for (it->SeekToFirst(); it->Valid(); it->Next()) {
     char *retvalue = const_cast<char*>(it->value().data());
-    std::auto_ptr< ::percolatorInNs::fragSpectrumScan> fss(deserializeFSSfromBinary(retvalue,it->value().size()));
-    ser.next ( PERCOLATOR_IN_NAMESPACE, "fragSpectrumScan", *fss);
+    std::auto_ptr< ::percolatorInNs::fragSpectrumScan> part(deserializeFSSfromBinary(retvalue,it->value().size()));
+    if(fss.get() && fss->scanNumber() == part->scanNumber())
+    {
+      mergeScans(*fss, *part);
+      continue;
+    }
+    if(fss.get())
+    {
+      if(scan2rt) storeRetentionTime(*fss);
+      writer.write(*fss);
+    }
+    fss = part;
+  }
+  if(fss.get())
+  {
+    if(scan2rt) storeRetentionTime(*fss);
+    writer.write(*fss);
   }
   delete it;
 
@@ -118,15 +160,40 @@ void FragSpectrumScanDatabaseLeveldb::putFSS( ::percolatorInNs::fragSpectrumScan
   assert(bdb);
   *oxdrp << fss;
   xdrrec_endofrecord (&xdr, true);
-  leveldb::WriteOptions write_options;
   ::percolatorInNs::fragSpectrumScan::scanNumber_type key = fss.scanNumber();
-  std::string skey = boost::lexical_cast<std::string>(key);
-  leveldb::Slice s2(buf.data(),buf.size());
-  leveldb::Slice s1(skey);
-  leveldb::Status status = bdb->Put(write_options,s1,s2);
+  batch.Put(scanKey(key, run), leveldb::Slice(buf.data(),buf.size()));
+  batchSize += buf.size();
+  buf.size(0);
+  // the batch is written in pieces of the size of the memtable
+  if(batchSize > options.write_buffer_size) writeBatch();
+}
+
+void FragSpectrumScanDatabaseLeveldb::writeBatch()
+{
+  if(batchSize == 0) return;
+  leveldb::WriteOptions write_options;
+  leveldb::Status status = bdb->Write(write_options, &batch);
   if(!status.ok())
   {
     throw MyException(status.ToString());
   }
-  buf.size(0);
+  batch.Clear();
+  batchSize = 0;
+}
+
+void FragSpectrumScanDatabaseLeveldb::flushPsms()
+{
+  if(pendingPsms.empty()) return;
+  if(VERB > 3)
+    cerr << "Writing the psms of " << pendingPsms.size() << " scans to " << id << " as run " << run << endl;
+  PsmBuffer::iterator it;
+  for(it = pendingPsms.begin(); it != pendingPsms.end(); it++)
+  {
+    ::percolatorInNs::fragSpectrumScan fss(it->first);
+    addPendingPsms( it->second, fss );
+    putFSS( fss );
+  }
+  writeBatch();
+  clearPendingPsms();
+  run++;
 }
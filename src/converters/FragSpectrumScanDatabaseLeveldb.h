@@ -20,6 +20,7 @@
 
 #include "FragSpectrumScanDatabase.h"
 #include "leveldb/db.h"
+#include "leveldb/write_batch.h"
 #include <rpc/types.h>
 #include <rpc/xdr.h>
 
@@ -42,17 +43,33 @@ public:
   
   virtual std::auto_ptr< ::percolatorInNs::fragSpectrumScan> getFSS( unsigned int scanNr );
   
-  virtual void print(serializer & ser);
+  virtual void print(PinWriter & writer);
   
+  /** adds the scan to the run that is being written **/
   virtual void putFSS( ::percolatorInNs::fragSpectrumScan & fss );
   
+  /** writes the buffered psms as one run of scans in key order, without
+   *  reading the parts of the scans written by earlier runs **/
+  virtual void flushPsms();
+  
 private:
   
+  /** the scan number followed by the run, both big endian, so that the
+   *  runs of a scan are next to each other in scan number order. The scans
+   *  are printed in numeric order, as with the other databases, and no
+   *  longer in the lexicographic order of the decimal scan numbers **/
+  static std::string scanKey(unsigned int scanNr, unsigned int run);
+  
+  void writeBatch();
+  
   XDR xdr;
   xml_schema::buffer buf;
   std::auto_ptr< xml_schema::ostream<XDR> > oxdrp;
   leveldb::DB* bdb;
   leveldb::Options options;
+  leveldb::WriteBatch batch;
+  size_t batchSize;
+  unsigned int run;
   
 };
 
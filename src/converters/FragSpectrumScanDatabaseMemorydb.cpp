@@ -0,0 +1,96 @@
+#include "FragSpectrumScanDatabaseMemorydb.h"
+#include <algorithm>
+
+FragSpectrumScanDatabaseMemorydb::FragSpectrumScanDatabaseMemorydb(std::string id):FragSpectrumScanDatabase(id)
+{
+
+}
+
+FragSpectrumScanDatabaseMemorydb::~FragSpectrumScanDatabaseMemorydb()
+{
+  terminte();
+}
+
+string FragSpectrumScanDatabaseMemorydb::toString()
+{
+  return std::string("FragSpectrumScanDatabaseMemorydb");
+}
+
+bool FragSpectrumScanDatabaseMemorydb::init(std::string fileName) {
+  return true;
+}
+
+void FragSpectrumScanDatabaseMemorydb::terminte()
+{
+  mapscan::iterator it;
+  for (it = scans.begin(); it != scans.end(); it++)
+    delete it->second;
+  scans.clear();
+  setMemoryUsage(0);
+}
+
+void FragSpectrumScanDatabaseMemorydb::savePsm( unsigned int scanNr,
+    std::auto_ptr< percolatorInNs::peptideSpectrumMatch > psm_p ) 
+{
+  // the psm goes straight into its scan, there is nothing to buffer
+  size_t bytes = memoryUsage + psmMemory(*psm_p);
+  mapscan::iterator it = scans.find(scanNr);
+  if(it == scans.end())
+  {
+    it = scans.insert(mapscan::value_type(scanNr, 
+		      new ::percolatorInNs::fragSpectrumScan(scanNr))).first;
+    bytes += sizeof(::percolatorInNs::fragSpectrumScan) + sizeof(mapscan::value_type) + 4 * sizeof(void*);
+  }
+  it->second->peptideSpectrumMatch().push_back(psm_p);
+  setMemoryUsage(bytes);
+}
+
+std::auto_ptr< ::percolatorInNs::fragSpectrumScan> FragSpectrumScanDatabaseMemorydb::getFSS( unsigned int scanNr ) 
+{
+  mapscan::const_iterator it = scans.find(scanNr);
+  if(it == scans.end()){
+    return std::auto_ptr< ::percolatorInNs::fragSpectrumScan> (NULL);
+  }
+  return std::auto_ptr< ::percolatorInNs::fragSpectrumScan> (new ::percolatorInNs::fragSpectrumScan(*it->second));
+}
+
+void FragSpectrumScanDatabaseMemorydb::print(PinWriter & writer) 
+{
+  mapscan::const_iterator it;
+  for (it = scans.begin(); it != scans.end(); it++) 
+  {
+    // the psms are not buffered, so their retention times are set here
+    if(scan2rt) storeRetentionTime(*it->second);
+    writer.write(*it->second);
+  }
+}
+
+void FragSpectrumScanDatabaseMemorydb::putFSS( ::percolatorInNs::fragSpectrumScan & fss ) 
+{
+  ::percolatorInNs::fragSpectrumScan::scanNumber_type key = fss.scanNumber();
+  size_t bytes = memoryUsage;
+  mapscan::iterator it = scans.find(key);
+  if(it == scans.end())
+  {
+    it = scans.insert(mapscan::value_type(key, new ::percolatorInNs::fragSpectrumScan(fss))).first;
+    bytes += sizeof(::percolatorInNs::fragSpectrumScan) + sizeof(mapscan::value_type) + 4 * sizeof(void*);
+  }
+  else
+  {
+    // the psms of the scan are replaced, e.g. by the retention times
+    for (fragSpectrumScan::peptideSpectrumMatch_const_iterator psm = it->second->peptideSpectrumMatch().begin(); 
+	 psm != it->second->peptideSpectrumMatch().end(); ++psm)
+      bytes -= std::min(bytes, psmMemory(*psm));
+    *it->second = fss;
+  }
+  for (fragSpectrumScan::peptideSpectrumMatch_const_iterator psm = fss.peptideSpectrumMatch().begin(); 
+       psm != fss.peptideSpectrumMatch().end(); ++psm)
+    bytes += psmMemory(*psm);
+  setMemoryUsage(bytes);
+}
+
+std::auto_ptr< ::percolatorInNs::fragSpectrumScan> FragSpectrumScanDatabaseMemorydb::deserializeFSSfromBinary( char * value, int valueSize ) 
+{
+  // the scans are never serialized
+  return std::auto_ptr< ::percolatorInNs::fragSpectrumScan> (NULL);
+}
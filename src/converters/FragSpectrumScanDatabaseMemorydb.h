@@ -0,0 +1,57 @@
+/*******************************************************************************
+ Copyright 2006-2012 Lukas Käll <lukas.kall@scilifelab.se>
+
+ Licensed under the Apache License, Version 2.0 (the "License");
+ you may not use this file except in compliance with the License.
+ You may obtain a copy of the License at
+
+ http://www.apache.org/licenses/LICENSE-2.0
+
+ Unless required by applicable law or agreed to in writing, software
+ distributed under the License is distributed on an "AS IS" BASIS,
+ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ See the License for the specific language governing permissions and
+ limitations under the License.
+
+ *******************************************************************************/
+
+#ifndef FRAGSPECTRUMSCANDATABASEMEMORYDB_H
+#define FRAGSPECTRUMSCANDATABASEMEMORYDB_H
+
+#include "FragSpectrumScanDatabase.h"
+
+typedef std::map<unsigned int, ::percolatorInNs::fragSpectrumScan*, std::less<unsigned int> > mapscan;
+
+/** keeps the scans as objects ordered by scan number, without serializing
+ *  them, for runs that fit in memory **/
+class FragSpectrumScanDatabaseMemorydb: public FragSpectrumScanDatabase
+{
+
+public:
+
+  FragSpectrumScanDatabaseMemorydb(std::string id = 0);
+  
+  virtual ~FragSpectrumScanDatabaseMemorydb();
+  
+  virtual std::string toString();  
+  
+  virtual bool init(std::string fileName);
+  
+  virtual void terminte();
+  
+  virtual void savePsm(unsigned int scanNr, auto_ptr<peptideSpectrumMatch> psm_p );
+  
+  virtual std::auto_ptr< ::percolatorInNs::fragSpectrumScan> getFSS( unsigned int scanNr );
+  
+  virtual void print(PinWriter & writer);
+  
+  virtual void putFSS( ::percolatorInNs::fragSpectrumScan & fss );
+  
+  virtual auto_ptr<fragSpectrumScan> deserializeFSSfromBinary(char* value,int valueSize);
+  
+private:
+ 
+   mapscan scans;
+};
+
+#endif // FRAGSPECTRUMSCANDATABASEMEMORYDB_H
@@ -44,6 +44,9 @@ bool FragSpectrumScanDatabaseTokyoDB::init(std::string fileName)
   assert(bdb);
   bool ret =  tcbdbsetcmpfunc(bdb, tccmpint32, NULL);
   assert(ret);
+  // the database is temporary and read once, so the records are not compressed
+  ret = tcbdbtune(bdb, 0, 0, 0, -1, -1, 0);
+  assert(ret);
   if(!tcbdbopen(bdb, fileName.c_str(), BDBOWRITER | BDBOTRUNC | BDBOREADER | BDBOCREAT )){
     int errorcode = tcbdbecode(bdb);
     ostringstream temp;
@@ -94,38 +97,56 @@ std::auto_ptr< ::percolatorInNs::fragSpectrumScan> FragSpectrumScanDatabaseTokyo
 std::auto_ptr< ::percolatorInNs::fragSpectrumScan> FragSpectrumScanDatabaseTokyoDB::getFSS( unsigned int scanNr ) 
 {
   assert(bdb);
-  int valueSize = 0;
-  char * value = ( char * ) tcbdbget(bdb, ( const char* ) &scanNr, sizeof( scanNr ), &valueSize);
-  if(!value) {
-    return std::auto_ptr< ::percolatorInNs::fragSpectrumScan> (NULL);
+  // the scan is merged from all the records it was written in
+  std::auto_ptr< ::percolatorInNs::fragSpectrumScan> ret;
+  TCLIST * values = tcbdbget4(bdb, ( const char* ) &scanNr, sizeof( scanNr ));
+  if(!values) {
+    return ret;
+  }
+  for(int i = 0; i < tclistnum(values); i++)
+  {
+    int valueSize = 0;
+    char * value = ( char * ) tclistval(values, i, &valueSize);
+    std::auto_ptr< ::percolatorInNs::fragSpectrumScan> part(deserializeFSSfromBinary(value,valueSize));
+    if(ret.get()) mergeScans(*ret, *part);
+    else ret = part;
   }
-  std::auto_ptr< ::percolatorInNs::fragSpectrumScan> ret(deserializeFSSfromBinary(value,valueSize));  
-  free(value);
+  tclistdel(values);
   return ret;
 }
 
-void FragSpectrumScanDatabaseTokyoDB::print(serializer & ser) 
+void FragSpectrumScanDatabaseTokyoDB::print(PinWriter & writer) 
 {
   BDBCUR *cursor;
-  char *key;
   assert(bdb);
   cursor = tcbdbcurnew(bdb);
   assert(cursor);
   tcbdbcurfirst(cursor);
-  // using tcbdbcurkey3 is probably faster
-  int keySize;
+  // one sequential pass over the database, the records of a scan are next to each other
   int valueSize;
-  while (( key = static_cast< char * > ( tcbdbcurkey(cursor,&keySize)) ) != 0 ) 
+  char * value;
+  std::auto_ptr< ::percolatorInNs::fragSpectrumScan> fss;
+  while (( value = static_cast< char * > ( tcbdbcurval(cursor,&valueSize)) ) != 0 ) 
   {
-    char * value = static_cast< char * > ( tcbdbcurval(cursor,&valueSize));
-    if(value)
+    std::auto_ptr< ::percolatorInNs::fragSpectrumScan> part(deserializeFSSfromBinary(value,valueSize));
+    free(value);
+    tcbdbcurnext(cursor);
+    if(fss.get() && fss->scanNumber() == part->scanNumber())
     {
-      std::auto_ptr< ::percolatorInNs::fragSpectrumScan> fss(deserializeFSSfromBinary(value,valueSize));
-      ser.next ( PERCOLATOR_IN_NAMESPACE, "fragSpectrumScan", *fss);
-      free(value);
+      mergeScans(*fss, *part);
+      continue;
     }
-    free(key);
-    tcbdbcurnext(cursor);
+    if(fss.get())
+    {
+      if(scan2rt) storeRetentionTime(*fss);
+      writer.write(*fss);
+    }
+    fss = part;
+  }
+  if(fss.get())
+  {
+    if(scan2rt) storeRetentionTime(*fss);
+    writer.write(*fss);
   }
   tcbdbcurdel(cursor);
 }
@@ -137,8 +158,8 @@ void FragSpectrumScanDatabaseTokyoDB::putFSS( ::percolatorInNs::fragSpectrumScan
   *oxdrp << fss;
   xdrrec_endofrecord (&xdr, true);
   size_t keySize = sizeof(key);
-  size_t valueSize(buf.size ());
-  if(!tcbdbput(bdb, ( const char * ) &key, keySize, buf.data (), buf.size () ))
+  // the record is added next to the earlier ones of the scan instead of replacing them
+  if(!tcbdbputdup(bdb, ( const char * ) &key, keySize, buf.data (), buf.size () ))
   {
     int  errorcode = tcbdbecode(bdb);
     ostringstream temp;
@@ -147,3 +168,18 @@ void FragSpectrumScanDatabaseTokyoDB::putFSS( ::percolatorInNs::fragSpectrumScan
   }
   buf.size(0);
 }
+
+void FragSpectrumScanDatabaseTokyoDB::flushPsms()
+{
+  if(pendingPsms.empty()) return;
+  if(VERB > 3)
+    cerr << "Writing the psms of " << pendingPsms.size() << " scans to " << id << endl;
+  PsmBuffer::iterator it;
+  for(it = pendingPsms.begin(); it != pendingPsms.end(); it++)
+  {
+    ::percolatorInNs::fragSpectrumScan fss(it->first);
+    addPendingPsms( it->second, fss );
+    putFSS( fss );
+  }
+  clearPendingPsms();
+}
@@ -42,10 +42,15 @@ public:
   
   virtual std::auto_ptr< ::percolatorInNs::fragSpectrumScan> getFSS( unsigned int scanNr );
   
-  virtual void print(serializer & ser);
+  virtual void print(PinWriter & writer);
   
+  /** adds the scan as a record of its own, after the earlier records of the scan **/
   virtual void putFSS( ::percolatorInNs::fragSpectrumScan & fss );
   
+  /** writes the buffered psms in key order, without reading the parts of
+   *  the scans that were written before **/
+  virtual void flushPsms();
+  
 private:
           
   XDR xdr;
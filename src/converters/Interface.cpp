@@ -99,7 +99,7 @@ bool Interface::parseOpt(int argc, char **argv,const std::string &usage)
       TRUE_IF_SET);
   cmd.defineOption("2",
       "ms2-file",
-      "File containing spectra and retention time. The file could be in mzXML, MS2 or compressed MS2 file.",
+      "File containing spectra and retention time. The file could be in mzXML, MS2 or compressed MS2 file. Several files can be given separated by commas.",
       "filename");
   cmd.defineOption("M",
       "isotope",
@@ -146,6 +146,13 @@ bool Interface::parseOpt(int argc, char **argv,const std::string &usage)
       "Maximum peptide mass allowed used in the search engine (default 6000)(Only valid when using option -F).",
       "",
       "number");
+  cmd.defineOption("k",
+      "max-memory",
+      "Stop with an error message as soon as the memory used by the converted PSMs exceeds the given number of megabytes. \
+      The buffered PSMs are written to the database at a quarter of this limit or at 64 MB, whichever is smaller. \
+      The default in-memory database and the Boost serialization keep all PSMs in memory, so with them the whole run \
+      has to fit within the limit; converters built with LevelDB or Tokyo Cabinet write the PSMs to disk instead",
+      "MB");
   
   // finally parse and handle return codes (display help etc...)
   cmd.parseArgs(argc, argv);
@@ -263,6 +270,12 @@ bool Interface::parseOpt(int argc, char **argv,const std::string &usage)
     parseOptions.maxmass = cmd.getInt("l",100,10000);
   }
   
+  if (cmd.optionSet("k"))
+  {
+    double maxMB = cmd.getDouble("k", 1.0, 1e9);
+    Globals::getInstance()->getProfiler()->setMaxMemory((size_t)(maxMB * 1048576.0));
+  }
+  
   if (cmd.arguments.size() > 0)
   {
     targetFN = cmd.arguments[0];
@@ -0,0 +1,65 @@
+#include "MappedFile.h"
+#include "MyException.h"
+#include <fstream>
+#if defined (__WIN32__) || defined (__MINGW__) || defined (MINGW) || defined (_WIN32)
+  #define NO_MMAP
+#else
+  #include <sys/types.h>
+  #include <sys/stat.h>
+  #include <sys/mman.h>
+  #include <fcntl.h>
+  #include <unistd.h>
+#endif
+
+MappedFile::MappedFile(const std::string &fn) : data(0), length(0), mapped(false)
+{
+#ifndef NO_MMAP
+  int fd = open(fn.c_str(), O_RDONLY);
+  struct stat info;
+  if (fd < 0 || fstat(fd, &info) != 0) 
+  {
+    if (fd >= 0) close(fd);
+    ostringstream temp;
+    temp << "Error : can not open file " << fn << std::endl;
+    throw MyException(temp.str());
+  }
+  length = (size_t)info.st_size;
+  if (length > 0) 
+  {
+    void* address = mmap(0, length, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (address != MAP_FAILED) 
+    {
+      // the readers go through the file once from start to end
+      madvise(address, length, MADV_SEQUENTIAL);
+      data = static_cast<const char*>(address);
+      mapped = true;
+    }
+  }
+  close(fd);
+  if (mapped || length == 0) return;
+#endif
+  // without mmap, or if it failed, the file is read into memory
+  std::ifstream in(fn.c_str(), std::ios::in | std::ios::binary);
+  if (!in) 
+  {
+    ostringstream temp;
+    temp << "Error : can not open file " << fn << std::endl;
+    throw MyException(temp.str());
+  }
+  in.seekg(0, std::ios::end);
+  length = (size_t)in.tellg();
+  in.seekg(0, std::ios::beg);
+  buffer.resize(length);
+  if (length > 0) 
+  {
+    in.read(&buffer[0], length);
+    data = &buffer[0];
+  }
+}
+
+MappedFile::~MappedFile()
+{
+#ifndef NO_MMAP
+  if (mapped) munmap(const_cast<char*>(data), length);
+#endif
+}
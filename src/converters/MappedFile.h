@@ -0,0 +1,58 @@
+/*******************************************************************************
+ Copyright 2006-2012 Lukas Käll <lukas.kall@scilifelab.se>
+
+ Licensed under the Apache License, Version 2.0 (the "License");
+ you may not use this file except in compliance with the License.
+ You may obtain a copy of the License at
+
+ http://www.apache.org/licenses/LICENSE-2.0
+
+ Unless required by applicable law or agreed to in writing, software
+ distributed under the License is distributed on an "AS IS" BASIS,
+ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ See the License for the specific language governing permissions and
+ limitations under the License.
+
+ *******************************************************************************/
+
+
+#ifndef MAPPEDFILE_H
+#define MAPPEDFILE_H
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+/**
+ * Read-only view of the content of a file. The file is memory mapped where
+ * mmap is available, so that the readers can tokenize it in place without
+ * copying it line by line; elsewhere it is read into a buffer.
+ */
+class MappedFile
+{
+  
+public:
+  
+  /** throws a MyException if the file can not be opened **/
+  MappedFile(const std::string &fn);
+  
+  ~MappedFile();
+  
+  const char* begin() const { return data; }
+  
+  const char* end() const { return data + length; }
+  
+  size_t size() const { return length; }
+  
+private:
+  
+  MappedFile(const MappedFile &);
+  MappedFile & operator=(const MappedFile &);
+  
+  const char* data;
+  size_t length;
+  bool mapped;
+  std::vector<char> buffer;
+};
+
+#endif // MAPPEDFILE_H
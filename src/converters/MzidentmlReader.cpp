@@ -1,10 +1,5 @@
 #include "MzidentmlReader.h"
 
-static const XMLCh sequenceCollectionStr[] = {chLatin_S, chLatin_e, chLatin_q, chLatin_u, chLatin_e, chLatin_n,
-  chLatin_c, chLatin_e, chLatin_C, chLatin_o, chLatin_l, chLatin_l, chLatin_e,
-  chLatin_c, chLatin_t, chLatin_i, chLatin_o, chLatin_n, chNull};
-
-
 static string schemaDefinition = Globals::getInstance()->getXMLDir()+MZIDENTML_SCHEMA_LOCATION + string("mzIdentML1.1.0.xsd");
 static string scheme_namespace = MZIDENTML_NAMESPACE;
 static string schema_major = boost::lexical_cast<string>(MZIDENTML_VERSION_MAJOR);
@@ -41,6 +36,10 @@ void MzidentmlReader::cleanHashMaps() {
     if(iter3->second) delete iter3->second;
     iter3->second = 0;
   }
+
+  peptideMap.clear();
+  proteinMap.clear();
+  peptideEvidenceMap.clear();
 }
 
 
@@ -126,43 +125,31 @@ void MzidentmlReader::read(const std::string &fn, bool isDecoy, boost::shared_pt
     xml_schema::dom::auto_ptr<xercesc_3_1::DOMDocument> doc
             (p.start(ifs, fn.c_str(), true, schemaDefinition, schema_major, schema_minor, scheme_namespace));
 
-    //NOTE wouldnt be  better to use the get tag by Name to jump SequenceCollenction directly?
-    while (doc.get() != 0 && !XMLString::equals(sequenceCollectionStr,
-            doc->getDocumentElement()->getTagName())) {
-      doc = p.next(); // Let's skip some sub trees that we are not interested, e.g. AuditCollection
-    }
-
-    assert(doc.get());
-    mzIdentML_ns::SequenceCollectionType sequenceCollection(*doc->getDocumentElement());
-
-    peptideMap.clear();
-    proteinMap.clear();
-    peptideEvidenceMap.clear();
-
-    //NOTE probably I can get rid of these hash tables with a proper access to elements by tag and id
-
-    BOOST_FOREACH(const mzIdentML_ns::SequenceCollectionType::Peptide_type &peptide, sequenceCollection.Peptide()) {
-      //PEPTIDE
-      mzIdentML_ns::SequenceCollectionType::Peptide_type *pept =
-              new mzIdentML_ns::SequenceCollectionType::Peptide_type(peptide);
-      peptideMap.insert(std::make_pair(peptide.id(), pept));
-    }
-
-    BOOST_FOREACH(const mzIdentML_ns::SequenceCollectionType::DBSequence_type &protein, sequenceCollection.DBSequence()) {
-      //PROTEIN
-      mzIdentML_ns::SequenceCollectionType::DBSequence_type *prot =
-              new mzIdentML_ns::SequenceCollectionType::DBSequence_type(protein);
-      proteinMap.insert(std::make_pair(protein.id(), prot));
-    }
-
-    BOOST_FOREACH(const ::mzIdentML_ns::PeptideEvidenceType &peptideE, sequenceCollection.PeptideEvidence()) {
-      //PEPTIDE EVIDENCE
-      ::mzIdentML_ns::PeptideEvidenceType *peptE = new mzIdentML_ns::PeptideEvidenceType(peptideE);
-      peptideEvidenceMap.insert(std::make_pair(peptideE.id(), peptE));
-    }
+    cleanHashMaps();
 
+    // The parser hands out the Peptide, DBSequence and PeptideEvidence entries of the
+    // SequenceCollection one at a time, so only the reference tables are kept in memory
+    // and never a DOM of the whole section. The spectrum identification results that follow
+    // are then streamed one by one into the database.
     for (doc = p.next(); doc.get() != 0 && !XMLString::equals(spectrumIdentificationResultStr,
             doc->getDocumentElement()->getTagName()); doc = p.next()) {
+      const DOMElement &element = *doc->getDocumentElement();
+      if (XMLString::equals(peptideStr, element.getTagName())) {
+        //PEPTIDE
+        mzIdentML_ns::SequenceCollectionType::Peptide_type *pept =
+                new mzIdentML_ns::SequenceCollectionType::Peptide_type(element);
+        peptideMap.insert(std::make_pair(pept->id(), pept));
+      } else if (XMLString::equals(dBSequenceStr, element.getTagName())) {
+        //PROTEIN
+        mzIdentML_ns::SequenceCollectionType::DBSequence_type *prot =
+                new mzIdentML_ns::SequenceCollectionType::DBSequence_type(element);
+        prot->Seq().reset(); // only the accession is used, the sequence can be most of the file
+        proteinMap.insert(std::make_pair(prot->id(), prot));
+      } else if (XMLString::equals(peptideEvidenceStr, element.getTagName())) {
+        //PEPTIDE EVIDENCE
+        ::mzIdentML_ns::PeptideEvidenceType *peptE = new mzIdentML_ns::PeptideEvidenceType(element);
+        peptideEvidenceMap.insert(std::make_pair(peptE->id(), peptE));
+      }
       // Let's skip some sub trees that we are not interested, e.g. AnalysisCollection
     }
 
@@ -0,0 +1,278 @@
+#include "PinWriter.h"
+#include "Globals.h"
+#include <cstdio>
+
+static const std::string pinNamespace = PERCOLATOR_IN_NAMESPACE;
+
+PinWriter::PinWriter(std::ostream &os) : out(os)
+{
+  buffer.reserve(bufferSize + 4096);
+}
+
+PinWriter::~PinWriter()
+{
+  flush();
+}
+
+void PinWriter::flush()
+{
+  out.write(buffer.data(), buffer.size());
+  buffer.clear();
+}
+
+void PinWriter::write(const std::string &text)
+{
+  buffer += text;
+}
+
+void PinWriter::writeElement(const std::string &name, const std::string &content)
+{
+  buffer += '<';
+  buffer += name;
+  buffer += '>';
+  escape(content, false);
+  buffer += "</";
+  buffer += name;
+  buffer += ">\n";
+}
+
+void PinWriter::write(const ::percolatorInNs::databases &databases)
+{
+  startTag("databases", true);
+  buffer += ">\n  ";
+  writeElement("target_database", databases.target_database());
+  buffer += "  ";
+  writeElement("decoy_database", databases.decoy_database());
+  buffer += "</databases>\n";
+}
+
+void PinWriter::write(const ::percolatorInNs::featureDescriptions &featureDescriptions)
+{
+  startTag("featureDescriptions", true);
+  buffer += ">\n";
+  ::percolatorInNs::featureDescriptions::featureDescription_const_iterator it;
+  for (it = featureDescriptions.featureDescription().begin();
+       it != featureDescriptions.featureDescription().end(); ++it)
+  {
+    buffer += "  ";
+    startTag("featureDescription");
+    if (it->description().present()) attribute("description", it->description().get());
+    if (it->initialValue().present()) attribute("initialValue", (double)it->initialValue().get());
+    attribute("name", it->name());
+    buffer += "/>\n";
+  }
+  buffer += "</featureDescriptions>\n";
+}
+
+void PinWriter::write(const ::percolatorInNs::fragSpectrumScan &fss)
+{
+  // the attributes are written in alphabetical order, as the xsd serializer does
+  startTag("fragSpectrumScan", true);
+  if (fss.experimentalMass().present()) attribute("experimentalMass", (double)fss.experimentalMass().get());
+  if (fss.precision().present()) attribute("precision", (double)fss.precision().get());
+  attribute("scanNumber", (long)fss.scanNumber());
+  if (fss.totalIonCurrent().present()) attribute("totalIonCurrent", (double)fss.totalIonCurrent().get());
+  buffer += ">\n";
+  ::percolatorInNs::fragSpectrumScan::peptideSpectrumMatch_const_iterator it;
+  for (it = fss.peptideSpectrumMatch().begin(); it != fss.peptideSpectrumMatch().end(); ++it)
+  {
+    write(*it);
+  }
+  buffer += "</fragSpectrumScan>\n";
+  if (buffer.size() > bufferSize) flush();
+}
+
+void PinWriter::write(const ::percolatorInNs::peptideSpectrumMatch &psm)
+{
+  buffer += "  ";
+  startTag("peptideSpectrumMatch");
+  attribute("calculatedMass", (double)psm.calculatedMass());
+  attribute("chargeState", (long)psm.chargeState());
+  attribute("experimentalMass", (double)psm.experimentalMass());
+  attribute("id", psm.id());
+  attribute("isDecoy", (bool)psm.isDecoy());
+  if (psm.observedTime().present()) attribute("observedTime", (double)psm.observedTime().get());
+  buffer += ">\n    <features>\n";
+  ::percolatorInNs::features::feature_const_iterator feature;
+  for (feature = psm.features().feature().begin(); feature != psm.features().feature().end(); ++feature)
+  {
+    buffer += "      <feature>";
+    number((double)*feature);
+    buffer += "</feature>\n";
+  }
+  buffer += "    </features>\n    <peptide>\n      ";
+  writeElement("peptideSequence", psm.peptide().peptideSequence());
+  ::percolatorInNs::peptideType::modification_const_iterator modification;
+  for (modification = psm.peptide().modification().begin();
+       modification != psm.peptide().modification().end(); ++modification)
+  {
+    write(*modification);
+  }
+  buffer += "    </peptide>\n";
+  ::percolatorInNs::peptideSpectrumMatch::occurence_const_iterator occurence;
+  for (occurence = psm.occurence().begin(); occurence != psm.occurence().end(); ++occurence)
+  {
+    buffer += "    ";
+    startTag("occurence");
+    attribute("flankC", occurence->flankC());
+    attribute("flankN", occurence->flankN());
+    attribute("proteinId", occurence->proteinId());
+    if (occurence->startPosition().present()) attribute("startPosition", (long)occurence->startPosition().get());
+    buffer += "/>\n";
+  }
+  buffer += "  </peptideSpectrumMatch>\n";
+}
+
+void PinWriter::write(const ::percolatorInNs::modificationType &modification)
+{
+  buffer += "      ";
+  startTag("modification");
+  if (modification.avgMassDelta().present()) attribute("avgMassDelta", (double)modification.avgMassDelta().get());
+  attribute("location", (long)modification.location());
+  if (modification.monoisotopicMassDelta().present())
+    attribute("monoisotopicMassDelta", (double)modification.monoisotopicMassDelta().get());
+  if (modification.residues().present()) attribute("residues", modification.residues().get());
+  if (!modification.uniMod().present() && !modification.freeMod().present())
+  {
+    buffer += "/>\n";
+    return;
+  }
+  buffer += ">\n";
+  if (modification.uniMod().present())
+  {
+    buffer += "        ";
+    startTag("uniMod");
+    attribute("accession", (long)modification.uniMod().get().accession());
+    if (modification.uniMod().get().name().present()) attribute("name", modification.uniMod().get().name().get());
+    buffer += "/>\n";
+  }
+  if (modification.freeMod().present())
+  {
+    buffer += "        ";
+    startTag("freeMod");
+    attribute("moniker", modification.freeMod().get().moniker());
+    if (modification.freeMod().get().name().present()) attribute("name", modification.freeMod().get().name().get());
+    buffer += "/>\n";
+  }
+  buffer += "      </modification>\n";
+}
+
+void PinWriter::write(const ::percolatorInNs::protein &protein)
+{
+  startTag("protein", true);
+  attribute("id", (double)protein.id());
+  attribute("isDecoy", (bool)protein.isDecoy());
+  buffer += ">\n  ";
+  writeElement("name", protein.name());
+  buffer += "  <length>";
+  number((double)protein.length());
+  buffer += "</length>\n  <totalMass>";
+  number((double)protein.totalMass());
+  buffer += "</totalMass>\n  ";
+  writeElement("sequence", protein.sequence());
+  buffer += "</protein>\n";
+  if (buffer.size() > bufferSize) flush();
+}
+
+void PinWriter::startTag(const char *name, bool topLevel)
+{
+  buffer += '<';
+  buffer += name;
+  if (topLevel)
+  {
+    // the elements are written one by one, so each carries the namespace
+    buffer += " xmlns=\"";
+    buffer += pinNamespace;
+    buffer += '"';
+  }
+}
+
+void PinWriter::attribute(const char *name, const std::string &value)
+{
+  buffer += ' ';
+  buffer += name;
+  buffer += "=\"";
+  escape(value, true);
+  buffer += '"';
+}
+
+void PinWriter::attribute(const char *name, double value)
+{
+  buffer += ' ';
+  buffer += name;
+  buffer += "=\"";
+  number(value);
+  buffer += '"';
+}
+
+void PinWriter::attribute(const char *name, long value)
+{
+  buffer += ' ';
+  buffer += name;
+  buffer += "=\"";
+  number(value);
+  buffer += '"';
+}
+
+void PinWriter::attribute(const char *name, bool value)
+{
+  buffer += ' ';
+  buffer += name;
+  buffer += (value ? "=\"true\"" : "=\"false\"");
+}
+
+void PinWriter::escape(const std::string &text, bool inAttribute)
+{
+  for (std::string::const_iterator it = text.begin(); it != text.end(); ++it)
+  {
+    switch (*it)
+    {
+      case '&': buffer += "&amp;"; break;
+      case '<': buffer += "&lt;"; break;
+      case '>': buffer += "&gt;"; break;
+      case '"':
+        if (inAttribute) buffer += "&quot;";
+        else buffer += '"';
+        break;
+      default: buffer += *it;
+    }
+  }
+}
+
+void PinWriter::number(double value)
+{
+  // the xsd serializer prints doubles with the default format of a stream
+  // with precision 15, which is what %.15g gives
+  if (value != value)
+  {
+    buffer += "NaN";
+  }
+  else if (value > 1.7976931348623157e308)
+  {
+    buffer += "INF";
+  }
+  else if (value < -1.7976931348623157e308)
+  {
+    buffer += "-INF";
+  }
+  else
+  {
+    char text[32];
+    int length = snprintf(text, sizeof(text), "%.15g", value);
+    buffer.append(text, length);
+  }
+}
+
+void PinWriter::number(long value)
+{
+  char text[24];
+  char *end = text + sizeof(text), *start = end;
+  unsigned long magnitude = (value < 0 ? 0ul - (unsigned long)value : (unsigned long)value);
+  do
+  {
+    *--start = (char)('0' + magnitude % 10);
+    magnitude /= 10;
+  } while (magnitude > 0);
+  if (value < 0) *--start = '-';
+  buffer.append(start, end - start);
+}
@@ -0,0 +1,82 @@
+/*******************************************************************************
+ Copyright 2006-2012 Lukas Käll <lukas.kall@scilifelab.se>
+
+ Licensed under the Apache License, Version 2.0 (the "License");
+ you may not use this file except in compliance with the License.
+ You may obtain a copy of the License at
+
+ http://www.apache.org/licenses/LICENSE-2.0
+
+ Unless required by applicable law or agreed to in writing, software
+ distributed under the License is distributed on an "AS IS" BASIS,
+ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ See the License for the specific language governing permissions and
+ limitations under the License.
+
+ *******************************************************************************/
+
+
+#ifndef PINWRITER_H
+#define PINWRITER_H
+
+#include <cstddef>
+#include <iostream>
+#include <string>
+#include "percolator_in.hxx"
+
+/**
+ * Writes the elements of a percolator_in document straight from the object
+ * model, without building a DOM for every element as the xsd serializer does.
+ * The text is collected in a buffer that is written to the stream in large
+ * blocks. Numbers are formatted as the xsd serializer does, so the output only
+ * differs from it in whitespace.
+ */
+class PinWriter
+{
+
+public:
+
+  PinWriter(std::ostream &os);
+
+  ~PinWriter();
+
+  /** appends text that is already XML, e.g. the header of the document **/
+  void write(const std::string &text);
+
+  /** appends an element with only text content, the content is escaped **/
+  void writeElement(const std::string &name, const std::string &content);
+
+  void write(const ::percolatorInNs::databases &databases);
+
+  void write(const ::percolatorInNs::featureDescriptions &featureDescriptions);
+
+  void write(const ::percolatorInNs::fragSpectrumScan &fss);
+
+  void write(const ::percolatorInNs::protein &protein);
+
+  /** writes the buffer to the stream **/
+  void flush();
+
+private:
+
+  PinWriter(const PinWriter &);
+  PinWriter & operator=(const PinWriter &);
+
+  void write(const ::percolatorInNs::peptideSpectrumMatch &psm);
+  void write(const ::percolatorInNs::modificationType &modification);
+
+  void startTag(const char *name, bool topLevel = false);
+  void attribute(const char *name, const std::string &value);
+  void attribute(const char *name, double value);
+  void attribute(const char *name, long value);
+  void attribute(const char *name, bool value);
+  void escape(const std::string &text, bool inAttribute);
+  void number(double value);
+  void number(long value);
+
+  std::ostream &out;
+  std::string buffer;
+  static const size_t bufferSize = 1 << 20;
+};
+
+#endif // PINWRITER_H
@@ -1,5 +1,9 @@
 #include "Reader.h"
+#include "MappedFile.h"
 #include <typeinfo>
+#include <cstring>
+#include <cctype>
+#include <limits>
 
 const std::string Reader::aaAlphabet("ACDEFGHIKLMNPQRSTVWY");
 const std::string Reader::ambiguousAA("BZJX");
@@ -50,6 +54,10 @@ Reader::~Reader()
 
 void Reader::init()
 {
+  // the globals and the profiler are created lazily without a lock, create them
+  // here before the files are read in parallel
+  Globals::getInstance()->getProfiler();
+
   // initializing xercesc objects corresponding to pin element...
   xercesc::XMLPlatformUtils::Initialize ();
 
@@ -133,6 +141,12 @@ void Reader::init()
   //once I have max/min charge I can put in the features
   addFeatureDescriptions(Enzyme::getEnzymeType() != Enzyme::NO_ENZYME);
 
+  // read retention time if the converter was invoked with -2 option, they are
+  // set on the psms when the database stores them
+  if (po->spectrumFN.size() > 0) {
+    readRetentionTime(po->spectrumFN);
+  }
+
   if (!po->iscombined)
   {
     translateFileToXML(po->targetFN, false /* is_decoy */,0,isMeta);
@@ -143,13 +157,6 @@ void Reader::init()
     translateFileToXML(po->targetFN, false /* is_decoy */,0,isMeta);
   }
 
-  // read retention time if the converter was invoked with -2 option
-  if (po->spectrumFN.size() > 0) {
-    readRetentionTime(po->spectrumFN);
-    databases[0]->initRTime(&scan2rt);
-    storeRetentionTime(databases[0]);
-  }
-
   xercesc::XMLPlatformUtils::Terminate();
 }
 
@@ -158,6 +165,13 @@ void Reader::print(ofstream &xmlOutputStream)
 
   xercesc::XMLPlatformUtils::Initialize ();
 
+  // all elements are written by one writer straight from the object model,
+  // it buffers the output and writes it to the stream in large blocks
+  std::ostream &os = (po->xmlOutputFN == "") ? static_cast<std::ostream&>(std::cout) : xmlOutputStream;
+  if (po->xmlOutputFN != "" && VERB>2)
+    cerr <<  "The output will be written to " << po->xmlOutputFN << endl;
+  PinWriter writer(os);
+
   string schema_major = boost::lexical_cast<string>(PIN_VERSION_MAJOR);
   string schema_minor = boost::lexical_cast<string>(PIN_VERSION_MINOR);
   string headerStr = "<?xml version=\"1.0\" encoding=\"UTF-8\"?> \n" +
@@ -166,103 +180,60 @@ void Reader::print(ofstream &xmlOutputStream)
       " xsi:schemaLocation=\"" + PERCOLATOR_IN_NAMESPACE +
       " https://github.com/percolator/percolator/raw/pin-" + schema_major +
       "-" + schema_minor + "/src/xml/percolator_in.xsd\"> \n";
+  writer.write(headerStr);
 
-  if (po->xmlOutputFN == "")
-    cout << headerStr;
-  else
-  {
-    xmlOutputStream << headerStr;
-    if (VERB>2)
-      cerr <<  "The output will be written to " << po->xmlOutputFN << endl;
-  }
-
-  string enzymeStr = "\n<enzyme>" + Enzyme::getStringEnzyme() + "</enzyme>\n";
-
-  if (po->xmlOutputFN == "")
-    cout << enzymeStr;
-  else
-    xmlOutputStream << enzymeStr;
+  writer.write("\n");
+  writer.writeElement("enzyme", Enzyme::getStringEnzyme());
 
   if(po->readProteins)
   {
-    serializer ser;
-    if (po->xmlOutputFN == "") ser.start (std::cout);
-    else ser.start (xmlOutputStream);
-
     ::percolatorInNs::databases databases(po->targetDb,po->decoyDb);
-    ser.next ( PERCOLATOR_IN_NAMESPACE, "databases",databases);
+    writer.write(databases);
   }
 
-  string commandLine = "\n<process_info>\n" +
-      string("  <command_line>") + po->call.substr(0,po->call.length()-1)
-      + "</command_line>\n" + "</process_info>\n";
-
-  if (po->xmlOutputFN == "")
-    cout << commandLine;
-  else
-    xmlOutputStream << commandLine;
+  writer.write("\n<process_info>\n  ");
+  writer.writeElement("command_line", po->call.substr(0,po->call.length()-1));
+  writer.write("</process_info>\n\n");
 
   if(VERB>2)
      cerr << "\nWriting output:\n";
-  // print to cout (or populate xml file)
   // print features
-  {
-    serializer ser;
-    if (po->xmlOutputFN == "") ser.start (std::cout);
-    else ser.start (xmlOutputStream);
-    ser.next ( PERCOLATOR_IN_NAMESPACE, "featureDescriptions",f_seq);
-  }
+  writer.write(f_seq);
 
   // print fragSpecturmScans
   if (VERB>2)
     std::cerr << "Databases : " << databases.size() << std::endl;
 
   for(int i=0; i<databases.size();i++) {
-    serializer ser;
-    if (po->xmlOutputFN == "") ser.start (std::cout);
-    else ser.start (xmlOutputStream);
     if(VERB>2){
       cerr << "outputting content of " << databases[i]->id
           << " (and correspondent decoy file)\n";
     }
-    databases[i]->print(ser);
+    databases[i]->flushPsms();
+    databases[i]->print(writer);
     databases[i]->terminte();
   }
 
   if(po->readProteins && !proteins.empty())
   {
-    if (po->xmlOutputFN == "") cout << "\n";
-    else xmlOutputStream << "\n";
-
-    serializer ser;
+    writer.write("\n");
     std::vector<Protein*>::const_iterator it;
-
-    if (po->xmlOutputFN == "") ser.start (std::cout);
-    else ser.start (xmlOutputStream);
-
     for (it = proteins.begin(); it != proteins.end(); it++)
     { //NOTE I should serialize in a Btree the object protein as the PSMs
-      //FIXME the serialization is creating a gap \o between elements
-      std::auto_ptr< ::percolatorInNs::protein> p (new ::percolatorInNs::protein((*it)->name,(*it)->length,
-							(*it)->totalMass,(*it)->sequence,(*it)->id,(*it)->isDecoy));
-      ser.next(PERCOLATOR_IN_NAMESPACE, "protein", *p);
+      ::percolatorInNs::protein p((*it)->name,(*it)->length,(*it)->totalMass,(*it)->sequence,(*it)->id,(*it)->isDecoy);
+      writer.write(p);
     }
-
-    if (po->xmlOutputFN == "") cout << "\n";
-    else  xmlOutputStream << "\n";
+    writer.write("\n");
   }
 
   // print closing tag
-  if (po->xmlOutputFN == "")
-    std::cout << "</experiment>" << std::endl;
-  else
-  {
-    xmlOutputStream << "</experiment>" << std::endl;
+  writer.write("</experiment>\n");
+  writer.flush();
+  os.flush();
+  if (po->xmlOutputFN != "")
     xmlOutputStream.close();
-  }
 
   xercesc::XMLPlatformUtils::Terminate();
-
 }
 
 
@@ -271,61 +242,7 @@ void Reader::translateFileToXML(const std::string &fn, bool isDecoy, unsigned in
 
     if(!isMeta)
     {
-      // there must be as many databases as lines in the metafile containing the
-      // files. If this is not the case, add a new one
-      if(databases.size()==lineNumber_par)
-      {
-	// initialize databese
-	std::auto_ptr<serialize_scheme> database(new serialize_scheme(fn));
-
-	//NOTE this is actually not needed in case we compile with the boost-serialization scheme
-	//indicate this with a flag and avoid the creating of temp files when using boost-serialization
-	if(database->toString() != "FragSpectrumScanDatabaseBoostdb")
-	{
-	  // create temporary directory to store the pointer to the database
-	  string tcf = "";
-	  char * tcd;
-	  string str;
-
-	  //TODO it would be nice to somehow avoid these declararions and therefore avoid the linking to
-	  //boost filesystem when we dont use them
-	  try
-	  {
-	    boost::filesystem::path ph = boost::filesystem::unique_path();
-	    boost::filesystem::path dir = boost::filesystem::temp_directory_path() / ph;
-	    boost::filesystem::path file("converters-tmp.tcb");
-	    tcf = std::string((dir / file).string());
-	    str =  dir.string();
-	    tcd = new char[str.size() + 1];
-	    std::copy(str.begin(), str.end(), tcd);
-	    tcd[str.size()] = '\0';
-	    if(boost::filesystem::is_directory(dir))
-	    {
-	      boost::filesystem::remove_all(dir);
-	    }
-
-	    boost::filesystem::create_directory(dir);
-	  }
-	  catch (boost::filesystem::filesystem_error &e)
-	  {
-	    std::cerr << e.what() << std::endl;
-	  }
-
-	  tmpDirs.resize(lineNumber_par+1);
-	  tmpDirs[lineNumber_par]=tcd;
-	  tmpFNs.resize(lineNumber_par+1);
-	  tmpFNs[lineNumber_par]=tcf;
-	  database->init(tmpFNs[lineNumber_par]);
-	}
-	else
-	{
-	  database->init("");
-	}
-
-	databases.resize(lineNumber_par+1);
-	databases[lineNumber_par]=database;
-	assert(databases.size()==lineNumber_par+1);
-      }
+      initDatabase(fn,lineNumber_par);
       if (VERB>1){
 	std::cerr << "Reading " << fn << std::endl;
       }
@@ -336,19 +253,114 @@ void Reader::translateFileToXML(const std::string &fn, bool isDecoy, unsigned in
       // we hopefully found a meta file
       if (VERB>1)
         std::cerr << "Found a meta file: " << fn <<std::endl;
-      unsigned int lineNumber=0;
+      std::vector<std::string> files;
       std::string line2;
       std::ifstream meta(fn.data(), std::ios::in);
       while (getline(meta, line2)) {
 	if (line2.size() > 0 && line2[0] != '#') {
 	  line2.erase(std::remove(line2.begin(),line2.end(),' '),line2.end());
-	  translateFileToXML(line2,isDecoy,lineNumber,false);
-	  lineNumber++;
+	  files.push_back(line2);
 	}
       }
       meta.close();
+      
+      for(unsigned int lineNumber = 0; lineNumber < files.size(); lineNumber++)
+      {
+	initDatabase(files[lineNumber],lineNumber);
+      }
+      
+      // every file goes to the database of its line, which are printed in the order of
+      // the metafile, so the files can be read in parallel when the reader allows it
+      std::vector<std::string> errors(files.size());
+      bool parallel = isThreadSafe();
+#pragma omp parallel for schedule(dynamic, 1) if(parallel)
+      for(int lineNumber = 0; lineNumber < (int)files.size(); lineNumber++)
+      {
+	try
+	{
+	  if (VERB>1){
+#pragma omp critical (converters_output)
+	    std::cerr << "Reading " << files[lineNumber] << std::endl;
+	  }
+	  read(files[lineNumber],isDecoy,databases[lineNumber]);
+	  databases[lineNumber]->flushPsms();
+	}
+	catch (const std::exception &e)
+	{
+	  errors[lineNumber] = e.what();
+	}
+      }
+      for(unsigned int lineNumber = 0; lineNumber < files.size(); lineNumber++)
+      {
+	if(!errors[lineNumber].empty()) throw MyException(errors[lineNumber]);
+      }
+    }
+  }
+
+void Reader::initDatabase(const std::string &fn, unsigned int lineNumber_par)
+{
+  if(databases.size()==lineNumber_par)
+  {
+    // initialize databese
+    std::auto_ptr<serialize_scheme> database(new serialize_scheme(fn));
+
+    //NOTE this is actually not needed in case we compile with the boost-serialization or the memory scheme
+    //indicate this with a flag and avoid the creating of temp files when using them
+    if(database->toString() != "FragSpectrumScanDatabaseBoostdb" && 
+       database->toString() != "FragSpectrumScanDatabaseMemorydb")
+    {
+      // create temporary directory to store the pointer to the database
+      string tcf = "";
+      char * tcd;
+      string str;
+
+      //TODO it would be nice to somehow avoid these declararions and therefore avoid the linking to
+      //boost filesystem when we dont use them
+      try
+      {
+        boost::filesystem::path ph = boost::filesystem::unique_path();
+        boost::filesystem::path dir = boost::filesystem::temp_directory_path() / ph;
+        boost::filesystem::path file("converters-tmp.tcb");
+        tcf = std::string((dir / file).string());
+        str =  dir.string();
+        tcd = new char[str.size() + 1];
+        std::copy(str.begin(), str.end(), tcd);
+        tcd[str.size()] = '\0';
+        if(boost::filesystem::is_directory(dir))
+        {
+          boost::filesystem::remove_all(dir);
+        }
+
+        boost::filesystem::create_directory(dir);
+      }
+      catch (boost::filesystem::filesystem_error &e)
+      {
+        std::cerr << e.what() << std::endl;
+      }
+
+      tmpDirs.resize(lineNumber_par+1);
+      tmpDirs[lineNumber_par]=tcd;
+      tmpFNs.resize(lineNumber_par+1);
+      tmpFNs[lineNumber_par]=tcf;
+      database->init(tmpFNs[lineNumber_par]);
     }
+    else
+    {
+      database->init("");
+    }
+
+    // the retention times go to the first database, as the scan numbers of the
+    // other files of a metafile do not refer to the spectrum file
+    if(lineNumber_par == 0 && po->spectrumFN.size() > 0)
+    {
+      database->initRTime(&scan2rt);
+    }
+
+    databases.resize(lineNumber_par+1);
+    databases[lineNumber_par]=database;
+    assert(databases.size()==lineNumber_par+1);
   }
+}
   
 void Reader::push_backFeatureDescription(const char * str, const char *description, double initvalue) {
 
@@ -477,62 +489,115 @@ double Reader::isPngasef(const string& peptide, bool isDecoy ) {
 }
 
 
-void Reader::parseDataBase(const char* seqfile, bool isDecoy, bool isCombined, unsigned &proteins_counter)
+//hash of a peptide sequence, used as its id so that the proteins do not need
+//to keep the sequences of their peptides
+static boost::uint64_t peptideHash(const char* begin, const char* end)
 {
+  boost::uint64_t hash = 14695981039346656037ULL;
+  for (; begin != end; ++begin)
+  {
+    hash ^= (unsigned char)*begin;
+    hash *= 1099511628211ULL;
+  }
+  return hash;
+}
 
+void Reader::parseDataBase(const char* seqfile, bool isDecoy, bool isCombined, unsigned &proteins_counter)
+{
+  std::vector<Protein*> newProteins;
   try
   {
-    filebuf fb;
-    fb.open (seqfile,ios::in);
-    istream buffer(&fb);
     if (VERB>1)
       std::cerr << "Reading fasta file : " << seqfile << std::endl;
-    if (!buffer.eof())
+    MappedFile fasta(seqfile);
+
+    // first split the file in its records, the header line and the sequence lines of
+    // every record are parsed and digested in parallel below
+    std::vector<const char*> records;
+    const char* pos = fasta.begin();
+    const char* end = fasta.end();
+    while (pos != end && isspace((unsigned char)*pos)) ++pos;
+    if (pos != end && *pos != '>')
     {
-	  wchar_t c;
-	  while (!buffer.eof())
+      ostringstream temp;
+      temp << "Error : parsing fasta file " << "Incorrect format next character is " << *pos << std::endl;
+      throw MyException(temp.str());
+    }
+    while (pos != end)
+    {
+      records.push_back(pos);
+      do
+      {
+	pos = static_cast<const char*>(memchr(pos, '\n', end - pos));
+	pos = (pos == 0 ? end : pos + 1);
+      } while (pos != end && *pos != '>');
+    }
+    records.push_back(end);
+
+    std::vector<double> residueMass(256, 0.0);
+    initResidueMasses(residueMass);
+    Enzyme::getEnzyme(); // the enzyme is created here and not by the threads
+
+    int numberRecords = (int)records.size() - 1;
+    newProteins.resize(numberRecords, 0);
+    std::vector<std::string> errors(numberRecords);
+#pragma omp parallel for schedule(dynamic, 64)
+    for (int ix = 0; ix < numberRecords; ++ix)
+    {
+      try
+      {
+	const char* line = records[ix] + 1;
+	const char* lineEnd = static_cast<const char*>(memchr(line, '\n', records[ix + 1] - line));
+	if (lineEnd == 0) lineEnd = records[ix + 1];
+	Protein *protein = new Protein();
+	newProteins[ix] = protein;
+	// the name is the header line up to the first blank, the rest is a comment
+	const char* nameEnd = line;
+	while (nameEnd != lineEnd && *nameEnd != ' ' && *nameEnd != '\t') ++nameEnd;
+	if (nameEnd == line) nameEnd = lineEnd;
+	for (const char* c = line; c != nameEnd; ++c)
+	{
+	  if (*c != '\r') protein->name += *c;
+	}
+	for (const char* c = lineEnd; c != records[ix + 1]; ++c)
+	{
+	  if (isspace((unsigned char)*c)) continue;
+	  if ((*c >= 'A' && *c <= 'Z') || modifiedAA.find(*c) != std::string::npos)
+	  {
+	    protein->sequence += *c;
+	  }
+	  else
 	  {
-	    c = buffer.peek();
-	    if( c == '>' )
-	    {
-	      std::string protein_name;
-	      std::string protein_seq;
-	      read_from_fasta(buffer,protein_name,protein_seq);
-	      //std::cerr << " Reading " << protein_name << " " << protein_seq << std::endl;
-	      if(isCombined) isDecoy = protein_name.find(po->reversedFeaturePattern,0) != std::string::npos;
-	      std::set<std::string> peptides;
-	      double totalMass = 0.0;
-	      //NOTE here I should check the enzyme and do the according digestion a switch
-	      //unsigned num_tryptic = calculateProtLengthElastase(protein_seq,peptides,totalMass);
-	      unsigned num_tryptic = calculateProtLengthTrypsin(protein_seq,peptides,totalMass);
-	      //unsigned num_tryptic = calculateProtLengthChymotrypsin(protein_seq,peptides,totalMass);
-	      //unsigned num_tryptic = calculateProtLengthThermolysin(protein_seq,peptides,totalMass);
-	      //unsigned num_tryptic = calculateProtLengthProteinasek(protein_seq,peptides,totalMass);
-	      Protein *tmp = new Protein();
-	      tmp->id = ++proteins_counter;
-	      tmp->name = protein_name;
-	      tmp->isDecoy = isDecoy;
-	      tmp->sequence = protein_seq;
-	      tmp->peptides = peptides;
-	      tmp->length = num_tryptic;
-	      tmp->totalMass = totalMass;
-	      proteins.push_back(tmp);
-	   }
-	 }
+	    ostringstream temp;
+	    temp << "Error : parsing fasta file " << "Incorrect fasta sequence character " << *c << std::endl;
+	    throw MyException(temp.str());
+	  }
+	}
+	protein->length = calculateProtLength(protein->sequence,protein->peptides,protein->totalMass,residueMass);
+      }
+      catch (const std::exception &e)
+      {
+	errors[ix] = e.what();
+      }
     }
-    else
+    for (int ix = 0; ix < numberRecords; ++ix)
     {
-      fb.close();
-      ostringstream temp;
-      temp <<  "Error : reading combined database : " << seqfile <<  std::endl;
-      throw MyException(temp.str());
+      if (!errors[ix].empty()) throw MyException(errors[ix]);
     }
 
-    buffer.clear();
-    fb.close();
+    for (int ix = 0; ix < numberRecords; ++ix)
+    {
+      Protein *tmp = newProteins[ix];
+      if(isCombined) isDecoy = tmp->name.find(po->reversedFeaturePattern,0) != std::string::npos;
+      tmp->id = ++proteins_counter;
+      tmp->isDecoy = isDecoy;
+      proteins.push_back(tmp);
+    }
+    newProteins.clear();
 
   }catch(const std::exception &e)
   {
+    for (unsigned int ix = 0; ix < newProteins.size(); ++ix) delete newProteins[ix];
     throw MyException(std::string(e.what()));
   }
 
@@ -554,8 +619,30 @@ void Reader::parseDataBase(const char* seqfile, bool isDecoy, bool isCombined, u
   return;
 }
 
-unsigned int Reader::calculateProtLengthTrypsin(const string &protsequence,
-						set< string >& peptides, double& totalMass)
+void Reader::initResidueMasses(std::vector<double> &residueMass)
+{
+  // the masses used by calculatePepMAss, looked up once so that the digestion
+  // threads do not touch the maps; residues without a valid mass are NaN
+  for (unsigned int c = 0; c < residueMass.size(); ++c)
+  {
+    residueMass[c] = std::numeric_limits<double>::quiet_NaN();
+    if (aaAlphabet.find((char)c) != string::npos || ambiguousAA.find((char)c) != string::npos ||
+        additionalAA.find((char)c) != string::npos)
+    {
+      std::map<char, double>::const_iterator it = massMap_.find((char)c);
+      residueMass[c] = (it == massMap_.end() ? 0.0 : it->second);
+    }
+    else if (modifiedAA.find((char)c) != std::string::npos)
+    {
+      std::map<char,int>::const_iterator it = po->ptmScheme.find((char)c);
+      if (it != po->ptmScheme.end() && ptmMass.count(it->second) > 0)
+	residueMass[c] = ptmMass.find(it->second)->second;
+    }
+  }
+}
+
+unsigned int Reader::calculateProtLength(const string &protsequence, std::vector<boost::uint64_t> &peptides,
+					 double& totalMass, const std::vector<double> &residueMass)
 {
   size_t length = protsequence.length();
 
@@ -563,43 +650,51 @@ unsigned int Reader::calculateProtLengthTrypsin(const string &protsequence,
     --length;
   }
 
-  for(size_t start=0; start<length; start++)
+  // the cleavage sites of the enzyme given with -e, and the ends of the protein
+  std::vector<size_t> sites(1, 0);
+  for (size_t pos = 1; pos < length; pos++)
+  {
+    if (Enzyme::isEnzymatic(protsequence[pos-1], protsequence[pos])) sites.push_back(pos);
+  }
+  if (length > 0) sites.push_back(length);
+
+  // without an enzyme every residue is a site, the number of missed cleavages is then not limited
+  size_t maxMissed = (Enzyme::getEnzymeType() == Enzyme::NO_ENZYME ? sites.size() : po->missed_cleavages);
+  const char* seq = protsequence.data();
+  double terminalMass = massMap_.find('o')->second;
+  double protonsMass = 2 * massMap_.find('h')->second;
+  for (size_t first = 0; first + 1 < sites.size(); first++)
   {
-    if( start == 0 || ( protsequence[start+1] != 'P'
-      && ( protsequence[start] == 'K' || protsequence[start] == 'R' ) ) )
+    for (size_t last = first + 1; last < sites.size() && last - first - 1 <= maxMissed; last++)
     {
-      int numMisCleavages = 0;
-      for(size_t end=start+1;( end<=length && numMisCleavages <= po->missed_cleavages );end++)
+      size_t peptideLength = sites[last] - sites[first];
+      if (peptideLength > po->maxpeplength) break;
+      if (peptideLength < po->peptidelength) continue;
+      // the same sum as calculatePepMAss
+      double mass = 0.0;
+      for (size_t pos = sites[first]; pos < sites[last]; pos++)
       {
-	//NOTE I am missing the case when a tryptip digested peptide has a K|R and P at the end of the sequence
-        if( (protsequence[end] == 'K' || protsequence[end] == 'R')
-	  && (protsequence[end+1] != 'P' || end == length ) )
+	double residue = residueMass[(unsigned char)seq[pos]];
+	if (residue != residue)
 	{
-	   int begin = start + 1;
-	   int finish = end - start;
-	   if(start == 0)
-	   {
-	     begin--;
-	     finish++;
-	   }
-	   std::string peptide = protsequence.substr(begin,finish);
-	   if(peptide.size() >= po->peptidelength && peptide.size() <= po->maxpeplength)
-	   {
-	      double  mass = calculatePepMAss(peptide);
-
-	      if((mass > po->minmass) && (mass < po->maxmass) )
-	      {
-		peptides.insert(peptide);
-		totalMass+=mass;
-	      }
-	   }
-
-	   numMisCleavages++;
-        }
+	  ostringstream temp;
+	  temp << "Error: estimating peptide mass, the amino acid "
+	  << seq[pos] << " is not valid." << std::endl;
+	  throw MyException(temp.str());
+	}
+	mass += residue;
+      }
+      mass = (mass + terminalMass + protonsMass + 1.00727649);
+      if((mass > po->minmass) && (mass < po->maxmass) )
+      {
+	peptides.push_back(peptideHash(seq + sites[first], seq + sites[last]));
+	totalMass+=mass;
       }
     }
   }
 
+  std::sort(peptides.begin(), peptides.end());
+  peptides.erase(std::unique(peptides.begin(), peptides.end()), peptides.end());
   return (unsigned)peptides.size();
 }
 
@@ -624,84 +719,6 @@ void Reader::readProteins(const string &filenameTarget,const string &fileNamedec
     }
 }
 
-void Reader::read_from_fasta(istream &buffer, std::string &name , std::string &seq)
-{
-  std::string comment;
-  char b[BUFFER_LEN+1];
-  b[BUFFER_LEN] = '\0';
-  stringstream buf;
-  char c = buffer.peek();
-
-   while (!buffer.eof() and (c == ' ' || c == '\n')) {
-      buffer.ignore(1);
-      if (!buffer.eof()) c = buffer.peek();
-   }
-
-   if (!buffer.eof() && c != '>') {
-      stringstream ss;
-      ss << "next character is " << c;
-      ss << "Error : parsing fasta file " << "Incorrect format " << ss.str() << std::endl;
-      throw MyException(ss.str());
-   }
-
-  buffer.getline(b, BUFFER_LEN);
-  name = string(b+1);
-  name.erase(std::remove(name.begin(), name.end(), '\r'), name.end());
-
-  long int pos;
-  {
-    long int pos1 = name.find(' ');
-    long int pos2 = name.find('\t');
-    if (pos1 != -1 && pos2 != -1)
-      pos = pos1 < pos2 ? pos1 : pos2;
-    else if (pos1 != -1)
-      pos = pos1;
-    else if (pos2 != -1)
-      pos = pos2;
-    else
-      pos = -1;
-  }
-
-  if (pos > 0) {
-    comment = name.substr(pos+1,name.length());
-    name = name.substr(0,pos);
-  }
-
-  string temp;
-  char char_temp;
-
-  while (!buffer.eof() && (buffer.peek() != '>')) {
-
-    buffer >> temp;
-    for (string::iterator iter = temp.begin(); iter != temp.end(); iter++) {
-
-      if ( ((*iter >= 'A') && (*iter <= 'Z')) || (modifiedAA.find(*iter) != std::string::npos) )
-      {
-	buf << *iter;
-      }
-      else
-      {
-	ostringstream temp;
-	temp << "Error : parsing fasta file " << "Incorrect fasta sequence character " << *iter << std::endl;
-	throw MyException(temp.str());
-      }
-    }
-
-    c = buffer.peek();
-
-    while (!buffer.eof() && (c == ' ' || c == '\n' || c == '\r'))
-    {
-      buffer.ignore(1);
-      if (!buffer.eof()) c = buffer.peek();
-    }
- }
-
-  seq = string(buf.str());
-
-  return;
-
-}
-
 double Reader::massDiff(double observedMass, double calculatedMass,unsigned int charge)
 {
   assert(charge > 0);
@@ -797,117 +814,192 @@ void Reader::initMassMap(bool useAvgMass)
     }
 }
 
-void Reader::readRetentionTime(const std::string &filename)
+void Reader::readRetentionTime(const std::string &filenames)
 {
-  MSReader r;
-  Spectrum s;
-  r.setFilter(MS2);
-  char* cstr = new char[filename.size() + 1];
-  strcpy(cstr, filename.c_str());
-  // read first spectrum
-  r.readFile(cstr, s);
-  while(s.getScanNumber() != 0)
+  // several spectrum files can be given separated by commas, they are indexed
+  // in parallel and merged in the order they were given
+  std::vector<std::string> files;
+  boost::split(files, filenames, boost::is_any_of(","));
+  std::vector<std::map<int, vector<double> > > fileRTimes(files.size());
+  std::vector<std::string> errors(files.size());
+#pragma omp parallel for schedule(dynamic, 1)
+  for(int i = 0; i < (int)files.size(); i++)
   {
-    // check whether an EZ line is available
-    if(s.sizeEZ() != 0)
+    try
     {
-      // for each EZ line (each psm)
-      for(int i = 0; i<s.sizeEZ(); i++)
-      {
-        // save experimental mass and retention time
-        scan2rt[s.getScanNumber()].push_back(s.atEZ(i).mh);
-        scan2rt[s.getScanNumber()].push_back(s.atEZ(i).pRTime);
+      if (VERB>1){
+#pragma omp critical (converters_output)
+	std::cerr << "Reading retention times from " << files[i] << std::endl;
       }
+      MSFileFormat format = MSReader().checkFileFormat(files[i].c_str());
+      if(format == ms2)
+	readMs2RetentionTime(files[i], fileRTimes[i]);
+      else if(format == mzXML)
+	readMzXMLRetentionTime(files[i], fileRTimes[i]);
+      else
+	readSpectraRetentionTime(files[i], fileRTimes[i]);
     }
-    // if no EZ line is available, check for an RTime lines
-    else if((double)s.getRTime() != 0)
-    {
-      scan2rt[s.getScanNumber()].push_back(s.getRTime());
-    }
-    // if neither EZ nor I lines are available
-    else
+    catch (const std::exception &e)
     {
-      delete[] cstr;
-      ostringstream temp;
-      temp << "Error : The ms2 in input file does not appear to contain retention time "
-          << "information. Please run without -2 option." << std::endl;
-      throw MyException(temp.str());
+      errors[i] = e.what();
     }
-    // read next scan
-    r.readFile(NULL, s);
   }
-  delete[] cstr;
+  for(unsigned int i = 0; i < files.size(); i++)
+  {
+    if(!errors[i].empty()) throw MyException(errors[i]);
+    // a scan that is in several files keeps the retention times of the first one
+    scan2rt.insert(fileRTimes[i].begin(), fileRTimes[i].end());
+  }
+}
+
+/** stores the retention times of a scan as MSReader gives them, the EZ lines
+ *  (experimental mass and retention time of every psm) or else the RTime **/
+static void addScanRetentionTime(int scanNr, float rTime, const std::vector<double> &ezTimes,
+				 std::map<int, vector<double> > &rTimes)
+{
+  if(!ezTimes.empty())
+  {
+    rTimes[scanNr].insert(rTimes[scanNr].end(), ezTimes.begin(), ezTimes.end());
+  }
+  else if(rTime != 0)
+  {
+    rTimes[scanNr].push_back(rTime);
+  }
+  else
+  {
+    ostringstream temp;
+    temp << "Error : The ms2 in input file does not appear to contain retention time "
+        << "information. Please run without -2 option." << std::endl;
+    throw MyException(temp.str());
+  }
 }
 
-void Reader::storeRetentionTime(boost::shared_ptr<FragSpectrumScanDatabase> database)
+/** copies the next field of the line [p,end) to a terminated buffer, so that
+ *  it is parsed with atof and atoi as MSReader does **/
+static bool nextMs2Field(const char* &p, const char* end, char* field, size_t size)
 {
-  // for each spectra from the ms2 file
-  typedef std::map<int, vector<double> > map_t;
-  BOOST_FOREACH(map_t::value_type& i, scan2rt)
-  {
-    // scan number
-    int scanNr = i.first;
-    // related retention times
-    vector<double>* rTimes = &(i.second);
-    if(database->getFSS(scanNr).get()!=0)
+  while (p < end && (*p == ' ' || *p == '\t' || *p == '\r' || *p == ',')) ++p;
+  if (p == end) return false;
+  size_t length = 0;
+  while (p < end && *p != ' ' && *p != '\t' && *p != '\r' && *p != ',')
+  {
+    if (length < size - 1) field[length++] = *p;
+    ++p;
+  }
+  field[length] = '\0';
+  return true;
+}
+
+void Reader::readMs2RetentionTime(const std::string &filename, std::map<int, vector<double> > &rTimes)
+{
+  // only the S and I lines are parsed, the Z lines and the peaks are skipped
+  MappedFile ms2In(filename);
+  const char* end = ms2In.end();
+  char field[64];
+  int scanNr = 0;
+  bool inScan = false;
+  float rTime = 0;
+  std::vector<double> ezTimes;
+  for (const char* p = ms2In.begin(); p < end; )
+  {
+    const char* eol = static_cast<const char*>(memchr(p, '\n', end - p));
+    if (!eol) eol = end;
+    if (*p == 'S')
     {
-      fragSpectrumScan fss = *(database->getFSS(scanNr));
-      fragSpectrumScan::peptideSpectrumMatch_sequence& psmSeq = fss.peptideSpectrumMatch();
-      // retention time to be stored
-      double storeMe = 0;
-      // if rTimes only contains one element
-      if(rTimes->size()==1)
-      {
-        // take that as retention time
-        storeMe = rTimes->at(0);
-      }
-      else
+      if (inScan) addScanRetentionTime(scanNr, rTime, ezTimes, rTimes);
+      const char* q = p + 1;
+      scanNr = nextMs2Field(q, eol, field, sizeof(field)) ? atoi(field) : 0;
+      inScan = true;
+      rTime = 0;
+      ezTimes.clear();
+    }
+    else if (*p == 'I' && inScan)
+    {
+      const char* q = p + 1;
+      if (nextMs2Field(q, eol, field, sizeof(field)))
       {
-        // else, take retention time of psm that has observed mass closest to
-        // theoretical mass (smallest massDiff)
-        double massDiff = std::numeric_limits<double>::max(); // + infinity
-        for (fragSpectrumScan::peptideSpectrumMatch_iterator psmIter_i = psmSeq.begin(); psmIter_i != psmSeq.end(); ++psmIter_i)
+	if (strcmp(field, "RTime") == 0)
 	{
-          // skip decoy
-          if(psmIter_i->isDecoy() != true)
+	  if (nextMs2Field(q, eol, field, sizeof(field))) rTime = (float)atof(field);
+	}
+	else if (strcmp(field, "EZ") == 0)
+	{
+	  // charge, M+H, retention time and area
+	  double mh = 0;
+	  float ezTime = 0;
+	  if (nextMs2Field(q, eol, field, sizeof(field)) && nextMs2Field(q, eol, field, sizeof(field)))
 	  {
-            double cm = psmIter_i->calculatedMass();
-            double em = psmIter_i->experimentalMass();
-            // if a psm with observed mass closer to theoretical mass is found
-            if(abs(cm-em) < massDiff)
-	    {
-              // update massDiff
-              massDiff = abs(cm-em);
-              // get corresponding retention time
-              vector<double>::const_iterator r = rTimes->begin();
-
-              // Loop over alternatives EZ-lines, choose the one with the smallest mass difference
-              double altMassDiff = std::numeric_limits<double>::max();  // + infinity
-              for(; r<rTimes->end(); r=r+2)  // Loops over the EZ-line mh values (rounded to one or two decimals...)
-	      {
-                double rrr = *r;  //mass+h
-                double exm = psmIter_i->experimentalMass();  //actually masstocharge
-                //FIXME: as rrr is m+h and exm is m/z, this ugly fix loops through many charges
-                double rrr_mz;
-                for(int charge = 1; charge<7; charge++) {
-                  rrr_mz = (rrr + (charge-1)*1.007276466) / charge;
-                  if(abs(rrr_mz-exm) < altMassDiff) {
-                    altMassDiff = abs(rrr_mz-exm);
-                    storeMe = *(r+1);
-                  }
-                }
-              }
-              r = rTimes->end();
-            }
-          }
-        }
-      }
-      // store retention time for all psms in fss
-      for (fragSpectrumScan::peptideSpectrumMatch_iterator psmIter = psmSeq.begin(); psmIter != psmSeq.end(); ++psmIter)
-      {
-        psmIter->observedTime().set(storeMe);
+	    mh = atof(field);
+	    if (nextMs2Field(q, eol, field, sizeof(field))) ezTime = (float)atof(field);
+	  }
+	  ezTimes.push_back(mh);
+	  ezTimes.push_back(ezTime);
+	}
       }
-      database->putFSS(fss);
     }
+    p = eol < end ? eol + 1 : end;
+  }
+  if (inScan) addScanRetentionTime(scanNr, rTime, ezTimes, rTimes);
+}
+
+void Reader::readMzXMLRetentionTime(const std::string &filename, std::map<int, vector<double> > &rTimes)
+{
+  // the headers of the scans are read through the index of the file, the
+  // peaks are never decoded
+  RAMPFILE* rampFile = rampOpenFile(filename.c_str());
+  if (rampFile == NULL)
+  {
+    ostringstream temp;
+    temp << "Error : could not open the spectrum file " << filename << std::endl;
+    throw MyException(temp.str());
+  }
+  int lastScan = 0;
+  ramp_fileoffset_t* scanIndex = readIndex(rampFile, getIndexOffset(rampFile), &lastScan);
+  struct ScanHeaderStruct scanHeader;
+  std::vector<double> noEzTimes;
+  try
+  {
+    for (int i = 1; scanIndex != NULL && i <= lastScan; i++)
+    {
+      // missing scans have no offset in the index
+      if (scanIndex[i] <= 0) continue;
+      readHeader(rampFile, scanIndex[i], &scanHeader);
+      if (scanHeader.msLevel != 2) continue;
+      addScanRetentionTime(scanHeader.acquisitionNum, (float)scanHeader.retentionTime, noEzTimes, rTimes);
+    }
+  }
+  catch (...)
+  {
+    free(scanIndex);
+    rampCloseFile(rampFile);
+    throw;
+  }
+  free(scanIndex);
+  rampCloseFile(rampFile);
+}
+
+void Reader::readSpectraRetentionTime(const std::string &filename, std::map<int, vector<double> > &rTimes)
+{
+  // the other formats, e.g. compressed MS2, are read spectrum by spectrum
+  MSReader r;
+  Spectrum s;
+  r.setFilter(MS2);
+  std::vector<char> cstr(filename.begin(), filename.end());
+  cstr.push_back('\0');
+  std::vector<double> ezTimes;
+  // read first spectrum
+  r.readFile(&cstr[0], s);
+  while(s.getScanNumber() != 0)
+  {
+    ezTimes.clear();
+    for(int i = 0; i<s.sizeEZ(); i++)
+    {
+      // save experimental mass and retention time
+      ezTimes.push_back(s.atEZ(i).mh);
+      ezTimes.push_back(s.atEZ(i).pRTime);
+    }
+    addScanRetentionTime(s.getScanNumber(), s.getRTime(), ezTimes, rTimes);
+    // read next scan
+    r.readFile(NULL, s);
   }
 }
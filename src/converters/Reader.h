@@ -41,6 +41,7 @@
 #include <boost/filesystem.hpp>
 #include <boost/algorithm/string.hpp> 
 #include <boost/assign.hpp>
+#include <boost/cstdint.hpp>
 #include "MSReader.h"
 #include "Spectrum.h"
 #include <assert.h>
@@ -61,9 +62,12 @@
 #elif defined __TOKYODB__ 
   #include "FragSpectrumScanDatabaseTokyodb.h"
   typedef FragSpectrumScanDatabaseTokyoDB serialize_scheme;
-#else
+#elif defined __BOOSTDB__
   #include "FragSpectrumScanDatabaseBoostdb.h"
   typedef FragSpectrumScanDatabaseBoostdb serialize_scheme;
+#else
+  #include "FragSpectrumScanDatabaseMemorydb.h"
+  typedef FragSpectrumScanDatabaseMemorydb serialize_scheme;
 #endif
    
 using namespace std;
@@ -87,7 +91,7 @@ public:
   unsigned id;
   bool isDecoy;
   unsigned length;
-  std::set<std::string> peptides;
+  std::vector<boost::uint64_t> peptides; // hashes of the distinct digested peptides
 };
 
 class Reader
@@ -115,11 +119,22 @@ public:
   
   virtual void getMaxMinCharge(const std::string &fn, bool isDecoy) = 0;
   
+  /** true when read() only writes to the database it is given, the files of
+   *  a metafile are then read in parallel **/
+  virtual bool isThreadSafe() { return false; }
+  
   virtual void addFeatureDescriptions(bool doEnzyme) = 0;
   
-  void readRetentionTime(const std::string &filename);
-	
-  void storeRetentionTime(boost::shared_ptr<FragSpectrumScanDatabase> database);
+  /** reads the retention times of the MS2 scans of the spectrum files given
+   *  with -2, the databases set them on the psms when they store them **/
+  void readRetentionTime(const std::string &filenames);
+  
+  /** only the headers of the scans are read, not the peaks **/
+  static void readMs2RetentionTime(const std::string &filename, std::map<int, vector<double> > &rTimes);
+  
+  static void readMzXMLRetentionTime(const std::string &filename, std::map<int, vector<double> > &rTimes);
+  
+  static void readSpectraRetentionTime(const std::string &filename, std::map<int, vector<double> > &rTimes);
   
   void push_backFeatureDescription(const char *str, const char *description = "", double initvalue = 0.0);
 
@@ -145,10 +160,12 @@ public:
   void parseDataBase(const char* seqfile, bool isDecoy,bool isCombined, 
 		     unsigned &proteins_counter);
   
-  unsigned calculateProtLengthTrypsin(const std::string &protsequence,
-				      std::set<std::string> &peptides,double &totalMass);
+  /** digests the protein with the enzyme given with -e, stores the hashes of the
+   *  distinct peptides and returns their number **/
+  unsigned calculateProtLength(const std::string &protsequence, std::vector<boost::uint64_t> &peptides,
+			       double &totalMass, const std::vector<double> &residueMass);
   
-  void read_from_fasta(istream &buffer, std::string &name , std::string &seq); 
+  void initResidueMasses(std::vector<double> &residueMass);
   
   double massDiff(double observedMass, double calculatedMass,unsigned int charge);
   
@@ -156,6 +173,9 @@ public:
   
 private:
   
+   /** creates the database of line lineNumber_par of a metafile, if it is not there yet **/
+   void initDatabase(const std::string &fn, unsigned int lineNumber_par);
+   
    std::vector<char*> tmpDirs;
    std::vector<std::string> tmpFNs;
 
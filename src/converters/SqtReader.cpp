@@ -1,4 +1,70 @@
 #include "SqtReader.h"
+#include "MappedFile.h"
+#include <cstdlib>
+#include <cstring>
+
+/** helpers to tokenize the lines of a mapped SQT file in place **/
+
+static inline bool isBlank(char c)
+{
+  return c == ' ' || c == '\t' || c == '\r' || c == '\n' || c == '\v' || c == '\f';
+}
+
+static const char* endOfLine(const char* p, const char* end)
+{
+  const char* eol = static_cast<const char*>(memchr(p, '\n', end - p));
+  return eol ? eol : end;
+}
+
+/** next whitespace separated field of the line [p,end), false if there is none **/
+static bool nextField(const char* &p, const char* end, const char* &field, size_t &size)
+{
+  while (p < end && isBlank(*p)) ++p;
+  if (p == end) return false;
+  field = p;
+  while (p < end && !isBlank(*p)) ++p;
+  size = p - field;
+  return true;
+}
+
+/** parses the leading number of the next field as the >> operator would **/
+template <typename T>
+static bool nextNumber(const char* &p, const char* end, T &value)
+{
+  while (p < end && isBlank(*p)) ++p;
+  char number[64];
+  size_t size = 0;
+  while (p + size < end && size < sizeof(number) - 1 && !isBlank(p[size])) 
+  {
+    number[size] = p[size];
+    ++size;
+  }
+  number[size] = '\0';
+  char* stop;
+  double parsed = strtod(number, &stop);
+  if (stop == number) return false;
+  if ((T)1 / 2 == 0) 
+  {
+    // integers stop at the decimal point
+    stop = number;
+    if (*stop == '+' || *stop == '-') ++stop;
+    while (isdigit(*stop)) ++stop;
+    if (stop == number || !isdigit(stop[-1])) return false;
+    parsed = strtol(number, 0, 10);
+  }
+  value = (T)parsed;
+  p += stop - number;
+  return true;
+}
+
+static bool skipFields(const char* &p, const char* end, int n)
+{
+  const char* field;
+  size_t size;
+  for (int i = 0; i < n; ++i)
+    if (!nextField(p, end, field, size)) return false;
+  return true;
+}
 
 
 //default score vector //TODO move this to a file or input parameter                          
@@ -24,7 +90,7 @@ SqtReader::~SqtReader()
 
 }
 
-void SqtReader::readPSM(bool isDecoy, const std::string &in,int match,  
+void SqtReader::readPSM(bool isDecoy, const SqtRecord &record,int match,  
 			std::string psmId,boost::shared_ptr<FragSpectrumScanDatabase> database) 
 {
 
@@ -34,74 +100,80 @@ void SqtReader::readPSM(bool isDecoy, const std::string &in,int match,
   double observedMassCharge;
   double calculatedMassToCharge;
 
-  std::istringstream instr(in), linestr;
-  std::ostringstream idbuild;
-  int ourPos;
-  std::string line, tmp;
-
-  double mass, deltCn, tmpdbl, otherXcorr = 0.0, xcorr = 0.0, lastXcorr = 0.0, nSM = 0.0, tstSM = 0.0;
+  double deltCn, tmpdbl, otherXcorr = 0.0, xcorr = 0.0, lastXcorr = 0.0, nSM = 0.0, tstSM = 0.0;
   bool gotL = true;
   int ms = 0;
   std::string peptide;
   percolatorInNs::features::feature_sequence & f_seq =  features_p->feature();
   std::string protein;
   std::vector< std::string > proteinIds;
-  std::map<char,int> ptmMap = po->ptmScheme; 
+  const std::map<char,int> &ptmMap = po->ptmScheme; 
 
-  while (getline(instr, line)) 
+  for (size_t ix = 0; ix < record.size(); ++ix) 
   {
-    if (line[0] == 'S') 
+    const char* line = record[ix].first;
+    const char* end = record[ix].second;
+    const char* p = line;
+    assert(line != end);
+    if (*line == 'S') 
     {
-      linestr.clear();
-      linestr.str(line);
-      if (!(linestr >> tmp >> tmpdbl >> scan >> charge >> tmpdbl)) 
+      if (!(skipFields(p, end, 2) && nextNumber(p, end, scan) && nextNumber(p, end, charge) 
+	    && nextNumber(p, end, tmpdbl))) 
       {
 	ostringstream temp;
-        temp << "Error : can not parse the S line: " << line << endl;
+        temp << "Error : can not parse the S line: " << std::string(line, end) << endl;
 	throw MyException(temp.str());
       }
       // Computer name might not be set, just skip this part of the line
-      linestr.ignore(256, '\t');
-      linestr.ignore(256, '\t');
+      for (int tab = 0; tab < 2; ++tab) 
+      {
+	const char* next = static_cast<const char*>(memchr(p, '\t', std::min<size_t>(256, end - p)));
+	p = next ? next + 1 : std::min(p + 256, end);
+      }
       // First assume a MacDonald et al definition of S (9 fields)
-      if (!(linestr >> observedMassCharge >> tmpdbl >> tmpdbl >> nSM)) 
+      if (!(nextNumber(p, end, observedMassCharge) && nextNumber(p, end, tmpdbl) 
+	    && nextNumber(p, end, tmpdbl) && nextNumber(p, end, nSM))) 
       {
 	ostringstream temp;
-        temp << "Error : can not parse the S line: " << line << endl;
+        temp << "Error : can not parse the S line: " << std::string(line, end) << endl;
 	throw MyException(temp.str());
       }
       // Check if the Yate's lab definition (10 fields) is valid
       // http://fields.scripps.edu/sequest/SQTFormat.html
       //
-      if (linestr >> tstSM) 
+      if (nextNumber(p, end, tstSM)) 
       {
         nSM = tstSM;
       }
     }
-    if (line[0] == 'M') 
+    if (*line == 'M') 
     {
-      linestr.clear();
-      linestr.str(line);
-
       if (ms == 1) 
       {
-        linestr >> tmp >> tmp >> tmp >> tmp >> deltCn >> otherXcorr;
-        lastXcorr = otherXcorr;
+        if (skipFields(p, end, 4) && nextNumber(p, end, deltCn) && nextNumber(p, end, otherXcorr))
+	  lastXcorr = otherXcorr;
+	else
+	  lastXcorr = otherXcorr = 0.0;
       } 
       else 
       {
-        linestr >> tmp >> tmp >> tmp >> tmp >> tmp >> lastXcorr;
+        if (!(skipFields(p, end, 5) && nextNumber(p, end, lastXcorr))) lastXcorr = 0.0;
       }
       if (match == ms) 
       {
         double rSp, sp, matched, expected;
-        linestr.seekg(0, ios::beg);
-        if (!(linestr >> tmp >> tmp >> rSp >> calculatedMassToCharge >> tmp >> xcorr >> sp >> matched >> expected >> peptide)) 
+	const char* field;
+	size_t size;
+        p = line;
+        if (!(skipFields(p, end, 2) && nextNumber(p, end, rSp) && nextNumber(p, end, calculatedMassToCharge) 
+	      && skipFields(p, end, 1) && nextNumber(p, end, xcorr) && nextNumber(p, end, sp) 
+	      && nextNumber(p, end, matched) && nextNumber(p, end, expected) && nextField(p, end, field, size))) 
 	{
 	  ostringstream temp;
-	  temp << "Error : can not parse the M line: " << line << endl;
+	  temp << "Error : can not parse the M line: " << std::string(line, end) << endl;
 	  throw MyException(temp.str());
         }
+        peptide.assign(field, size);
         
         // difference between observed and calculated mass
         double dM = massDiff(observedMassCharge, calculatedMassToCharge,charge);
@@ -144,16 +216,19 @@ void SqtReader::readPSM(bool isDecoy, const std::string &in,int match,
       }
       ms++;
     }
-    assert(line.size() != 0 );
 
-    if (line.at(0) == 'L' && !gotL) 
+    if (*line == 'L' && !gotL) 
     {
-      if (instr.peek() != 'L') gotL = true;
+      if (ix + 1 == record.size() || *record[ix + 1].first != 'L') gotL = true;
       
-      line = line.substr(0, 2) + getRidOfUnprintables(line.substr(2));
-      linestr.clear();
-      linestr.str(line);
-      linestr >> tmp >> protein;
+      // the first field after L, without the unprintable characters
+      std::string printable = std::string(line, std::min(line + 2, end)) + 
+			      getRidOfUnprintables(std::string(std::min(line + 2, end), end));
+      p = printable.data();
+      const char* field;
+      size_t size;
+      if (skipFields(p, p + printable.size(), 1) && nextField(p, p + printable.size(), field, size))
+	protein.assign(field, size);
       
       proteinIds.push_back(protein);
       
@@ -192,7 +267,7 @@ void SqtReader::readPSM(bool isDecoy, const std::string &in,int match,
 	ambiguousAA.find(peptideS[ix])==string::npos && 
 	additionalAA.find(peptideS[ix])==string::npos)
     {
-      int accession = ptmMap[peptideS[ix]];
+      int accession = ptmMap.find(peptideS[ix])->second;
       std::auto_ptr< percolatorInNs::uniMod > um_p (new percolatorInNs::uniMod(accession));
       std::auto_ptr< percolatorInNs::modificationType >  mod_p( new percolatorInNs::modificationType(ix));
       mod_p->uniMod(um_p);
@@ -222,60 +297,34 @@ void SqtReader::readPSM(bool isDecoy, const std::string &in,int match,
 
 void SqtReader::getMaxMinCharge(const std::string &fn, bool isDecoy)
 {
-  int charge = 0;
-  std::string line;
-  std::istringstream lineParse;
-  std::ifstream sqtIn;
-  unsigned int scanExtra;
-  std::string tmp;
-  
-  sqtIn.open(fn.c_str(), std::ios::in);
-  if (!sqtIn) 
+  // only the S lines followed by matches are parsed, the rest of the file is skipped
+  MappedFile sqtIn(fn);
+  const char* end = sqtIn.end();
+  for (const char* p = sqtIn.begin(); p < end; ) 
   {
-    ostringstream temp;
-    temp << "Error : can not open file " << fn << std::endl;
-    throw MyException(temp.str());
-  }
-
-  while (getline(sqtIn, line)) 
-  {
-    if (line[0] == 'S' && sqtIn.peek() != 'S') 
+    const char* eol = endOfLine(p, end);
+    const char* next = eol < end ? eol + 1 : end;
+    if (*p == 'S' && (next == end || *next != 'S')) 
     {
-      lineParse.clear();
-      lineParse.str(line);
-      lineParse >> tmp >> tmp >> scanExtra >> charge;
-      minCharge = std::min(minCharge,charge);
-      maxCharge = std::max(maxCharge,charge);
+      const char* q = p;
+      unsigned int scanExtra;
+      int charge = 0;
+      if (skipFields(q, eol, 2) && nextNumber(q, eol, scanExtra) && nextNumber(q, eol, charge)) 
+      {
+        minCharge = std::min(minCharge,charge);
+        maxCharge = std::max(maxCharge,charge);
+      }
     }
-     
+    p = next;
   }
-  sqtIn.close();
 }
 
 
 void SqtReader::read(const std::string &fn, bool isDecoy,boost::shared_ptr<FragSpectrumScanDatabase> database) 
 {
+  MappedFile sqtIn(fn);
 
-  std::string ptmAlphabet;
-  int label;
-  double *feature, *regressionFeature;
-  int numSpectra;
-  std::string fileId;
-  int charge;
-  int n = 0, ms = 0;
-  std::string line, tmp, prot;
-  std::istringstream lineParse;
-  std::ifstream sqtIn;
-  sqtIn.open(fn.c_str(), std::ios::in);
-  if (!sqtIn) 
-  {
-    ostringstream temp;
-    temp << "Error : can not open file " << fn << std::endl;
-    throw MyException(temp.str());
-  }
-
-  std::string seq;
-  fileId = fn;
+  std::string fileId = fn;
   size_t spos = fileId.rfind('/');
   if (spos != std::string::npos) 
   {  
@@ -286,58 +335,61 @@ void SqtReader::read(const std::string &fn, bool isDecoy,boost::shared_ptr<FragS
   {
     fileId.erase(spos);
   }
-  std::ostringstream buff, id;
-  int ix = 0, lines = 0;
-  std::string scan;
+  
+  // the S, M and L lines of the spectrum are kept as ranges of the mapped file
+  SqtRecord record;
+  std::string id;
   std::set<int> theMs;
-  unsigned int scanNr2;
-
-  while (getline(sqtIn, line)) 
+  int ms = 0;
+  const char* end = sqtIn.end();
+  for (const char* p = sqtIn.begin(); p < end; ) 
   {
-    if (line[0] == 'S') 
+    const char* eol = endOfLine(p, end);
+    if (*p == 'S') 
     {
-      if (lines > 1) 
+      if (record.size() > 1) 
       {
-        readSectionS( buff.str(), theMs, isDecoy,id.str(), database);
+        readSectionS(record, theMs, isDecoy, id, database);
       }
-      buff.str("");
-      buff.clear();
-      id.str("");
-      lines = 1;
-      buff << line << std::endl;
-      lineParse.clear();
-      lineParse.str(line);
-      lineParse >> tmp >> tmp >> scan >> charge;
-      id << fileId << '_' << scan << '_' << charge;
+      record.clear();
+      record.push_back(std::make_pair(p, eol));
+      const char* q = p;
+      const char* scan = q;
+      size_t scanSize = 0;
+      int charge = 0;
+      skipFields(q, eol, 2);
+      nextField(q, eol, scan, scanSize);
+      nextNumber(q, eol, charge);
+      std::ostringstream idbuild;
+      idbuild << fileId << '_' << std::string(scan, scanSize) << '_' << charge;
+      id = idbuild.str();
       ms = 0;
       theMs.clear();
     }
-    if (line[0] == 'M') 
+    if (*p == 'M') 
     {
       ++ms;
-      ++lines;
-      buff << line << std::endl;
+      record.push_back(std::make_pair(p, eol));
     }
-    if (line[0] == 'L') 
+    if (*p == 'L') 
     {
-      ++lines;
-      buff << line << std::endl;
-     if ((int)theMs.size() < po->hitsPerSpectrum && 
-       ( !isDecoy || ( po->reversedFeaturePattern == "" || 
-       ((line.find(po->reversedFeaturePattern, 0) != std::string::npos)))))
+      record.push_back(std::make_pair(p, eol));
+      if ((int)theMs.size() < po->hitsPerSpectrum && 
+        ( !isDecoy || ( po->reversedFeaturePattern == "" || 
+        std::search(p, eol, po->reversedFeaturePattern.begin(), po->reversedFeaturePattern.end()) != eol)))
       {
 	  theMs.insert(ms - 1);
       }
     }
+    p = eol < end ? eol + 1 : end;
   }
-  if (lines > 1) 
+  if (record.size() > 1) 
   {
-    readSectionS(buff.str(), theMs, isDecoy, id.str(), database);
+    readSectionS(record, theMs, isDecoy, id, database);
   }
-  sqtIn.close();
 }
 
-void  SqtReader::readSectionS(const std::string &record,std::set<int> & theMs, bool isDecoy,
+void  SqtReader::readSectionS(const SqtRecord &record,std::set<int> & theMs, bool isDecoy,
 			       std::string psmId,boost::shared_ptr<FragSpectrumScanDatabase> database) 
 {
   std::set<int>::const_iterator it;
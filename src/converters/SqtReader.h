@@ -20,6 +20,9 @@
 
 #include "Reader.h"
 
+/** the lines of a spectrum in a SQT file, as ranges of the file **/
+typedef std::vector<std::pair<const char*, const char*> > SqtRecord;
+
 class SqtReader: public Reader
 {
 
@@ -32,18 +35,24 @@ public:
   void read(const std::string &fn, bool isDecoy,
 		    boost::shared_ptr<FragSpectrumScanDatabase> database);
 
-  void readSectionS(const std::string &record,std::set<int> &theMs, bool isDecoy,
+  void readSectionS(const SqtRecord &record,std::set<int> &theMs, bool isDecoy,
 	            std::string psmId,boost::shared_ptr<FragSpectrumScanDatabase> database);
 
-  void readPSM(bool isDecoy, const std::string &in,int match, 
+  void readPSM(bool isDecoy, const SqtRecord &record,int match, 
 	       std::string psmId,boost::shared_ptr<FragSpectrumScanDatabase> database);
   
   bool checkValidity(const std::string &file);
   
   bool checkIsMeta(const std::string &file);
  
+  // a separate pass over the mapped file before any read(): the charge range
+  // of all files fixes the charge features in the middle of every feature
+  // vector, so it cannot be collected while the psms are converted
   void getMaxMinCharge(const std::string &fn, bool isDecoy);
   
+  // read() only touches the database it is given
+  bool isThreadSafe() { return true; }
+  
   void addFeatureDescriptions(bool doEnzyme);
   
 protected:
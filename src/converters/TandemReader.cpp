@@ -3,6 +3,7 @@
 static const XMLCh groupStr[] = { chLatin_g, chLatin_r, chLatin_o, chLatin_u, chLatin_p, chNull};
 static const XMLCh groupTypeStr[] = { chLatin_t, chLatin_y, chLatin_p, chLatin_e, chNull};
 static const XMLCh groupModelStr[] = { chLatin_m, chLatin_o, chLatin_d, chLatin_e, chLatin_l, chNull};
+static const XMLCh groupChargeStr[] = { chLatin_z, chNull};
 static const std::string schemaDefinition = Globals::getInstance()->getXMLDir()+TANDEM_SCHEMA_LOCATION + string("tandem2011.12.01.1.xsd");
 static const std::string scheme_namespace = TANDEM_NAMESPACE;
 static const std::string schema_major = boost::lexical_cast<string>(TANDEM_VERSION);
@@ -238,13 +239,12 @@ void TandemReader::getMaxMinCharge(const std::string &fn, bool isDecoy){
       if(XMLString::equals(groupStr,doc->getDocumentElement()->getTagName()) 
 	&& XMLString::equals(groupModelStr,doc->getDocumentElement()->getAttribute(groupTypeStr)))  
       {
-	tandem_ns::group groupObj(*doc->getDocumentElement()); //Parse to the codesynthesis object model
+	//The charge is read from the attribute, the object model is only needed for the first spectrum
+	const XMLCh* chargeAttr = doc->getDocumentElement()->getAttribute(groupChargeStr);
 	  
-	if(groupObj.z().present()) //We are sure we are not in parameters group so z(the charge) has to be present.
+	if(XMLString::stringLen(chargeAttr) > 0) //We are sure we are not in parameters group so z(the charge) has to be present.
 	{
-	  stringstream chargeStream (stringstream::in | stringstream::out);
-	  chargeStream << groupObj.z();
-	  chargeStream >> charge;
+	  charge = XMLString::parseInt(chargeAttr);
 	  if (minCharge > charge) minCharge = charge;
 	  if (maxCharge < charge) maxCharge = charge;
 	  nTot++;
@@ -257,6 +257,7 @@ void TandemReader::getMaxMinCharge(const std::string &fn, bool isDecoy){
 	}
 	if(firstPSM)
 	{
+	  tandem_ns::group groupObj(*doc->getDocumentElement()); //Parse to the codesynthesis object model
 	  //Check what type of scores/ions are present
 	  BOOST_FOREACH(const tandem_ns::protein &protObj, groupObj.protein()) //Protein
 	  {
@@ -317,9 +318,9 @@ void TandemReader::getMaxMinCharge(const std::string &fn, bool isDecoy){
 }
 
 //Get the groupObject which contains one spectra but might contain several psm. 
-//All psms are read, features calculated and the psm saved.
+//All psms are read, features calculated and the psms collected.
 void TandemReader::readSpectra(const tandem_ns::group &groupObj,bool isDecoy,
-			       boost::shared_ptr<FragSpectrumScanDatabase> database,const std::string &fn){
+			       psmListType &psms,const std::string &fn){
   
   std::ostringstream id;
   std::string fileId, proteinName;
@@ -375,7 +376,7 @@ void TandemReader::readSpectra(const tandem_ns::group &groupObj,bool isDecoy,
        {
 	  isDecoy = proteinName.find(po->reversedFeaturePattern, 0) != std::string::npos;
 	}
-	createPSM(domain, parenIonMass, charge, sumI, maxI, isDecoy, database, peptideProteinMap, psmId, spectraId);
+	createPSM(domain, parenIonMass, charge, sumI, maxI, isDecoy, psms, peptideProteinMap, psmId, spectraId);
       }//End of if rank<=po.hitsPerSpectrum
     }
   } //End of boost protein
@@ -400,13 +401,13 @@ void TandemReader::getPeptideProteinMap(const tandem_ns::group &groupObj,peptide
   return;
 }
 
-//Calculates some features then creates the psm and saves it
+//Calculates some features then creates the psm and adds it to the list of the spectrum
 void TandemReader::createPSM(const tandem_ns::peptide::domain_type &domain,double parenIonMass,unsigned charge,
-			      double sumI,double maxI,bool isDecoy, boost::shared_ptr<FragSpectrumScanDatabase> database,
+			      double sumI,double maxI,bool isDecoy, psmListType &psms,
 			      const peptideProteinMapType &peptideProteinMap,const string &psmId, int spectraId)
 {
 
-  std::map<char,int> ptmMap = po->ptmScheme;
+  const std::map<char,int> &ptmMap = po->ptmScheme;
   std::auto_ptr< percolatorInNs::features >  features_p( new percolatorInNs::features ());
   percolatorInNs::features::feature_sequence & f_seq =  features_p->feature();
   
@@ -490,7 +491,7 @@ void TandemReader::createPSM(const tandem_ns::peptide::domain_type &domain,doubl
 	ambiguousAA.find(peptideS[ix])==string::npos && 
 	additionalAA.find(peptideS[ix])==string::npos)
     {
-      int accession = ptmMap[peptideS[ix]];
+      int accession = ptmMap.find(peptideS[ix])->second;
       std::auto_ptr< percolatorInNs::uniMod > um_p (new percolatorInNs::uniMod(accession));
       std::auto_ptr< percolatorInNs::modificationType >  mod_p( new percolatorInNs::modificationType(ix));
       mod_p->uniMod(um_p);
@@ -576,23 +577,56 @@ void TandemReader::createPSM(const tandem_ns::peptide::domain_type &domain,doubl
     psm_p->occurence().push_back(oc_p);
   }
   
-  database->savePsm(spectraId, psm_p);
+  psms.push_back(std::make_pair(spectraId, psm_p.release()));
+}
+
+//Converts a batch of groups to psms, in parallel when OpenMP is available, and saves
+//them in the order of the file so that the output does not depend on the threads
+void TandemReader::readGroups(std::vector<xercesc::DOMDocument*> &groups, bool isDecoy,
+			      boost::shared_ptr<FragSpectrumScanDatabase> database, const std::string &fn)
+{
+  std::vector<psmListType> psms(groups.size());
+  std::vector<std::string> errors(groups.size());
+#pragma omp parallel for schedule(dynamic, 16)
+  for(int ix = 0; ix < (int)groups.size(); ++ix)
+  {
+    try
+    {
+      tandem_ns::group groupObj(*groups[ix]->getDocumentElement()); //Parse it the codesynthesis object model.
+      readSpectra(groupObj,isDecoy,psms[ix],fn); //The groupObj contains the psms
+    }
+    catch (const std::exception &e)
+    {
+      errors[ix] = e.what();
+    }
+    groups[ix]->release();
+  }
+  groups.clear();
+  
+  std::string error;
+  for(unsigned int ix = 0; ix < psms.size(); ++ix)
+  {
+    if(error.empty() && !errors[ix].empty()) error = errors[ix];
+    for(psmListType::iterator it = psms[ix].begin(); it != psms[ix].end(); ++it)
+    {
+      std::auto_ptr< percolatorInNs::peptideSpectrumMatch > psm_p(it->second);
+      if(error.empty()) database->savePsm(it->first, psm_p);
+    }
+  }
+  if(!error.empty()) throw MyException(error);
 }
 
 void TandemReader::read(const std::string &fn, bool isDecoy,
 			boost::shared_ptr<FragSpectrumScanDatabase> database)
 {
-  std::string line, tmp, prot;
-  std::istringstream lineParse;
-  std::ifstream tandemIn;
-  int spectraId;
-  
   namespace xml = xsd::cxx::xml;
   
   ifstream ifs;
   ifs.exceptions(ifstream::badbit|ifstream::failbit);
   ifs.open(fn.c_str());
   parser p;
+  double startTime = Profiler::getWallTime();
+  size_t numberGroups = 0;
   
   //Sending defaultNameSpace as the bool for validation since if its not fixed 
   //the namespace has to be added later and then we cant validate the schema and xml file.
@@ -603,22 +637,42 @@ void TandemReader::read(const std::string &fn, bool isDecoy,
   //tandem_ns::bioml biomlObj=biomlObj(*doc->getDocumentElement()); 
   //NOTE the root of the element, doesn't have any useful attributes
   
-  //Loops over the group elements which are the spectra and the last 3 are the input parameters
-  for (doc = p.next(); doc.get() != 0; doc = p.next ()) 
+  //Loops over the group elements which are the spectra and the last 3 are the input parameters.
+  //The parser hands out one group at a time, at most groupBatchSize of them are kept
+  //before they are converted, so the memory does not grow with the size of the file.
+  std::vector<xercesc::DOMDocument*> groups;
+  try
   {
-    //NOTE cant acess mixed content using codesynthesis, need to keep dom assoication. See the manual for tree parser and : 
-    //http://www.codesynthesis.com/pipermail/xsd-users/2008-October/002005.html
-    //Not implementet here
-    
-    //Check that the tag name is group and that its not the inputput parameters
-    if(XMLString::equals(groupStr,doc->getDocumentElement()->getTagName()) 
-      && XMLString::equals(groupModelStr,doc->getDocumentElement()->getAttribute(groupTypeStr))) 
+    for (doc = p.next(); doc.get() != 0; doc = p.next ()) 
     {
-      tandem_ns::group groupObj(*doc->getDocumentElement()); //Parse it the codesynthesis object model.
-      readSpectra(groupObj,isDecoy,database,fn); //The groupObj contains the psms
+      //NOTE cant acess mixed content using codesynthesis, need to keep dom assoication. See the manual for tree parser and : 
+      //http://www.codesynthesis.com/pipermail/xsd-users/2008-October/002005.html
+      //Not implementet here
+      
+      //Check that the tag name is group and that its not the inputput parameters
+      if(XMLString::equals(groupStr,doc->getDocumentElement()->getTagName()) 
+	&& XMLString::equals(groupModelStr,doc->getDocumentElement()->getAttribute(groupTypeStr))) 
+      {
+	groups.push_back(doc.release());
+	++numberGroups;
+	if(groups.size() >= groupBatchSize) readGroups(groups,isDecoy,database,fn);
+      }
     }
+    readGroups(groups,isDecoy,database,fn);
+  }
+  catch (...)
+  {
+    for(unsigned int ix = 0; ix < groups.size(); ++ix) groups[ix]->release();
+    throw;
   }
   ifs.close();
   
+  if(VERB>2)
+  {
+    double time = Profiler::getWallTime() - startTime;
+#pragma omp critical (converters_output)
+    std::cerr << "Read " << numberGroups << " spectra from " << fn << " in " << time << " s ("
+	      << (time > 0.0 ? numberGroups / time : 0.0) << " spectra/s), peak resident set size "
+	      << Profiler::getPeakRSS() / 1024.0 << " MB" << std::endl;
+  }
 }
-
@@ -28,6 +28,7 @@ using namespace std;
 using namespace xercesc;
 
 typedef map<std::string, set<std::string> > peptideProteinMapType;
+typedef std::vector<std::pair<int, percolatorInNs::peptideSpectrumMatch*> > psmListType;
 
 class TandemReader: public Reader
 {
@@ -46,6 +47,9 @@ public:
  
   void getMaxMinCharge(const std::string &fn, bool isDecoy);
   
+  // read() only touches the database it is given
+  bool isThreadSafe() { return true; }
+  
   void addFeatureDescriptions(bool doEnzyme);
   
 private:
@@ -59,14 +63,20 @@ private:
   bool c_score;
   bool firstPSM;
   
+  //Number of groups that are converted together
+  static const unsigned int groupBatchSize = 1024;
+  
   //Functions
+  void readGroups(std::vector<xercesc::DOMDocument*> &groups, bool isDecoy,
+		  boost::shared_ptr<FragSpectrumScanDatabase> database, const std::string &fn);
+  
   void readSpectra(const tandem_ns::group &groupObj,bool isDecoy,
-		   boost::shared_ptr<FragSpectrumScanDatabase> database,const std::string &fn);
+		   psmListType &psms,const std::string &fn);
   
   void getPeptideProteinMap(const tandem_ns::group &groupObj,peptideProteinMapType &peptideProteinMap);
   
   void createPSM(const tandem_ns::peptide::domain_type &domain,double parenIonMass,unsigned charge,
-		  double sumI,double maxI,bool isDecoy, boost::shared_ptr<FragSpectrumScanDatabase> database,
+		  double sumI,double maxI,bool isDecoy, psmListType &psms,
 		  const peptideProteinMapType &peptideProteinMap,const string &psmId, int spectraId);
 };
 
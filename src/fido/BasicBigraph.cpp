@@ -2,6 +2,9 @@
 // see license for more information
 
 #include "BasicBigraph.h"
+#include <cstring>
+#include <cstdlib>
+#include <cctype>
 
 BasicBigraph::BasicBigraph(): PsmThreshold(0.0),PeptideThreshold(1e-3),ProteinThreshold(1e-3),PeptidePrior(0.1)
 {
@@ -19,13 +22,38 @@ BasicBigraph::~BasicBigraph()
 
 }
 
+size_t BasicBigraph::getMemoryUsage() const
+{
+  size_t bytes = sizeof(BasicBigraph) + proteinsToPSMs.getMemoryUsage() + PSMsToProteins.getMemoryUsage();
+  for (int k=0; k<severedProteins.size(); k++)
+    bytes += sizeof(string) + severedProteins[k].size();
+  return bytes;
+}
+
+
+int BasicBigraph::lookupOrAdd(NameIndex & index, vector<string> & names, const string & name)
+{
+  // every name is hashed once; new names get the next integer id
+  pair<NameIndex::iterator, bool> ins = index.insert( make_pair(name, int(names.size())) );
+  if ( ins.second )
+    names.push_back(name);
+  return ins.first->second;
+}
 
 void BasicBigraph::read(Scores* fullset, bool multiple_labeled_peptides)
 {
   string pepName, protName;
   double value =  -10;
   int pepIndex = -1;
-  StringTable PSMNames, proteinNames;
+  NameIndex PSMIndex, proteinIndex;
+  vector<string> PSMNames, proteinNames;
+  vector<double> PSMWeights;
+  vector<pair<int,int> > edges;
+
+  PSMIndex.rehash( fullset->size() );
+  PSMNames.reserve( fullset->size() );
+  PSMWeights.reserve( fullset->size() );
+  edges.reserve( fullset->size() );
 
   vector<ScoreHolder>::iterator psm = fullset->begin();
   for (; psm!= fullset->end(); ++psm) 
@@ -51,34 +79,62 @@ void BasicBigraph::read(Scores* fullset, bool multiple_labeled_peptides)
       pepName += "*";
     }
     
-    if ( PSMNames.lookup(pepName) == -1 ){
-      add(PSMsToProteins, PSMNames, pepName);
-    }
-    pepIndex = PSMNames.lookup(pepName);
+    pepIndex = lookupOrAdd(PSMIndex, PSMNames, pepName);
+    if ( pepIndex == int(PSMWeights.size()) )
+      PSMWeights.push_back(-1.0);
 
     // r proteins
     set<string>::const_iterator pid = psm->pPSM->proteinIds.begin();
     for (; pid!= psm->pPSM->proteinIds.end(); ++pid) 
     {
       protName = getRidOfUnprintablesAndUnicode(*pid);
-      if ( proteinNames.lookup(protName) == -1 ){
-	add(proteinsToPSMs, proteinNames, protName);
-      }
-      connect(PSMNames, pepName, proteinNames, protName);
+      edges.push_back( make_pair(pepIndex, lookupOrAdd(proteinIndex, proteinNames, protName)) );
     }
     // p probability of the peptide match to the spectrum
     value = 1 - psm->pPSM->pep;
-    PSMsToProteins.weights[ pepIndex ] = max(PSMsToProteins.weights[pepIndex], value);
+    PSMWeights[ pepIndex ] = max(PSMWeights[pepIndex], value);
  }
 
-  PSMsToProteins.names = PSMNames.getItemsByNumber();
-  proteinsToPSMs.names = proteinNames.getItemsByNumber();
+  buildLayers(PSMNames, PSMWeights, proteinNames, edges);
   
   //NOTE this function is assigning PeptideThreshold probablity to all the PSMs with a prob below PeptideThreshold
   /**pseudoCountPSMs();**/
 }
 
 
+// tokenizer for the graph file format, working on a NUL terminated buffer
+
+static void skipWhitespace(const char * & pos)
+{
+  while ( *pos != '\0' && isspace((unsigned char)*pos) )
+    pos++;
+}
+
+// the next non whitespace character, false at the end of the buffer
+static bool nextCharacter(const char * & pos, char & c)
+{
+  skipWhitespace(pos);
+  if ( *pos == '\0' )
+    return false;
+  c = *pos++;
+  return true;
+}
+
+static void nextToken(const char * & pos, string & token)
+{
+  skipWhitespace(pos);
+  const char * start = pos;
+  while ( *pos != '\0' && ! isspace((unsigned char)*pos) )
+    pos++;
+  token.assign(start, pos);
+}
+
+static void skipLine(const char * & pos)
+{
+  while ( *pos != '\0' && *pos != '\n' )
+    pos++;
+}
+
 void BasicBigraph::read(istream & is,bool multiple_labeled_peptides)
 {
   char instr;
@@ -86,12 +142,23 @@ void BasicBigraph::read(istream & is,bool multiple_labeled_peptides)
   double value =  -10;
 
   int pepIndex = -1;
-  int chargeState = 0;
   int state = 'e';
 
-  StringTable PSMNames, proteinNames;
-
-  while ( is >> instr )
+  NameIndex PSMIndex, proteinIndex;
+  vector<string> PSMNames, proteinNames;
+  vector<double> PSMWeights;
+  vector<pair<int,int> > edges;
+
+  // the stream is read in large blocks and tokenized in place, instead of
+  // extracting every token from the stream separately
+  vector<char> text;
+  char block[65536];
+  while ( is.read(block, sizeof(block)) || is.gcount() > 0 )
+    text.insert(text.end(), block, block + is.gcount());
+  text.push_back('\0');
+  const char * pos = & text[0];
+
+  while ( nextCharacter(pos, instr) )
     {
 
       if ( instr == 'e' && (state == 'e' || state == 'p') )
@@ -104,19 +171,16 @@ void BasicBigraph::read(istream & is,bool multiple_labeled_peptides)
 		{
 		  throw MyException("Error: No previous peptide entry to use");
 		}
-	      PSMsToProteins.weights[ pepIndex ] = max(value, PSMsToProteins.weights[ pepIndex ]);
+	      PSMWeights[ pepIndex ] = max(value, PSMWeights[ pepIndex ]);
 	    }
 	  
-	  is >> pepName;
+	  nextToken(pos, pepName);
 	 
 	  //pepName = cleanPeptideSequence(pepName);
 	  
-	  if ( PSMNames.lookup(pepName) == -1 )
-	    {
-	      add(PSMsToProteins, PSMNames, pepName);
-	    }
-	  
-	  pepIndex = PSMNames.lookup(pepName);
+	  pepIndex = lookupOrAdd(PSMIndex, PSMNames, pepName);
+	  if ( pepIndex == int(PSMWeights.size()) )
+	    PSMWeights.push_back(-1.0);
 
 	  state = 'c';
 
@@ -127,27 +191,28 @@ void BasicBigraph::read(istream & is,bool multiple_labeled_peptides)
 	}
       else if ( instr == 'r' && ( state == 'c' || state == 'r' || state == 'p' ) )
 	{
-	  is >> protName;
-
-	  if ( proteinNames.lookup(protName) == -1 )
-	    add(proteinsToPSMs, proteinNames, protName);
+	  nextToken(pos, protName);
 
-	  connect(PSMNames, pepName, proteinNames, protName);
+	  edges.push_back( make_pair(pepIndex, lookupOrAdd(proteinIndex, proteinNames, protName)) );
 
 	  state = 'p';
 	}
       else if ( instr == 'p' && state == 'p' )
 	{
-	  is >> value;
+	  skipWhitespace(pos);
+	  char * end;
+	  value = strtod(pos, & end);
+	  if ( end == pos )
+	    throw MyException("Error: no peptide score after p for peptide entry " + pepName);
+	  pos = end;
 	  // this option scores peptides using only the best match
-	  PSMsToProteins.weights[ pepIndex ] = max(PSMsToProteins.weights[pepIndex], value);
+	  PSMWeights[ pepIndex ] = max(PSMWeights[pepIndex], value);
 	  state = 'e';
 	}
       else if ( instr == '#' )
 	{
 	  // comment line
-	  string garbage;
-	  getline(is, garbage);
+	  skipLine(pos);
 	}
       else
 	{
@@ -155,13 +220,149 @@ void BasicBigraph::read(istream & is,bool multiple_labeled_peptides)
 	}
     }
 
-  PSMsToProteins.names = PSMNames.getItemsByNumber();
-  proteinsToPSMs.names = proteinNames.getItemsByNumber();
+  buildLayers(PSMNames, PSMWeights, proteinNames, edges);
 
   //NOTE this function is assigning PeptideThreshold probablity to all the PSMs with a prob below PeptideThreshold
   /**pseudoCountPSMs();**/
 }
 
+// the binary dump starts with this tag, followed by the format version
+static const char binaryTag[] = "FIDOGRAPH";
+static const uint32_t binaryVersion = 1;
+
+template <typename T>
+static void writeValue(ostream & os, const T & value)
+{
+  os.write(reinterpret_cast<const char *>(& value), sizeof(T));
+}
+
+template <typename T>
+static void readValue(istream & is, T & value)
+{
+  if ( ! is.read(reinterpret_cast<char *>(& value), sizeof(T)) )
+    throw MyException("Error: the binary fido graph is truncated");
+}
+
+static void writeNames(ostream & os, const Array<string> & names)
+{
+  writeValue(os, uint32_t(names.size()));
+  for (int k=0; k<names.size(); k++)
+    {
+      writeValue(os, uint32_t(names[k].size()));
+      os.write(names[k].data(), names[k].size());
+    }
+}
+
+static void readNames(istream & is, vector<string> & names)
+{
+  uint32_t count, length;
+  readValue(is, count);
+  names.resize(count);
+  vector<char> buffer;
+  for (uint32_t k=0; k<count; k++)
+    {
+      readValue(is, length);
+      buffer.resize(length + 1);
+      if ( ! is.read(& buffer[0], length) )
+	throw MyException("Error: the binary fido graph is truncated");
+      names[k].assign(& buffer[0], length);
+    }
+}
+
+bool BasicBigraph::isBinary(istream & is)
+{
+  char tag[sizeof(binaryTag)];
+  istream::pos_type start = is.tellg();
+  bool binary = is.read(tag, sizeof(tag)) && memcmp(tag, binaryTag, sizeof(tag)) == 0;
+  is.clear();
+  is.seekg(start);
+  return binary;
+}
+
+void BasicBigraph::writeBinary(ostream & os) const
+{
+  os.write(binaryTag, sizeof(binaryTag));
+  writeValue(os, binaryVersion);
+
+  writeNames(os, PSMsToProteins.names);
+  for (int k=0; k<PSMsToProteins.size(); k++)
+    writeValue(os, PSMsToProteins.weights[k]);
+  writeNames(os, proteinsToPSMs.names);
+
+  // the PSM to protein adjacency as compressed rows
+  uint32_t numberEdges = 0;
+  for (int k=0; k<PSMsToProteins.size(); k++)
+    {
+      writeValue(os, numberEdges);
+      numberEdges += PSMsToProteins.associations[k].size();
+    }
+  writeValue(os, numberEdges);
+  for (int k=0; k<PSMsToProteins.size(); k++)
+    {
+      const Set & as = PSMsToProteins.associations[k];
+      for (int j=0; j<as.size(); j++)
+	writeValue(os, int32_t(as[j]));
+    }
+}
+
+void BasicBigraph::readBinary(istream & is)
+{
+  char tag[sizeof(binaryTag)];
+  uint32_t version;
+  if ( ! is.read(tag, sizeof(tag)) || memcmp(tag, binaryTag, sizeof(tag)) != 0 )
+    throw MyException("Error: the file is not a binary fido graph");
+  readValue(is, version);
+  if ( version != binaryVersion )
+    throw MyException("Error: unsupported version of the binary fido graph");
+
+  vector<string> PSMNames, proteinNames;
+  readNames(is, PSMNames);
+  vector<double> PSMWeights(PSMNames.size());
+  for (unsigned int k=0; k<PSMNames.size(); k++)
+    readValue(is, PSMWeights[k]);
+  readNames(is, proteinNames);
+
+  vector<uint32_t> offsets(PSMNames.size()+1);
+  for (unsigned int k=0; k<offsets.size(); k++)
+    readValue(is, offsets[k]);
+  vector<pair<int,int> > edges;
+  edges.reserve(offsets.back());
+  for (unsigned int k=0; k<PSMNames.size(); k++)
+    for (uint32_t j=offsets[k]; j<offsets[k+1]; j++)
+      {
+	int32_t protIndex;
+	readValue(is, protIndex);
+	if ( protIndex < 0 || protIndex >= int32_t(proteinNames.size()) )
+	  throw MyException("Error: invalid protein index in the binary fido graph");
+	edges.push_back( make_pair(int(k), int(protIndex)) );
+      }
+
+  buildLayers(PSMNames, PSMWeights, proteinNames, edges);
+}
+
+void BasicBigraph::buildLayers(const vector<string> & PSMNames, const vector<double> & PSMWeights, const vector<string> & proteinNames, const vector<pair<int,int> > & edges)
+{
+  // the (PSM, protein) id pairs are packed into both directions at
+  // once, instead of growing the sorted association sets edge by edge
+  CSRAdjacency PSMAdjacency(PSMNames.size(), edges);
+  CSRAdjacency proteinAdjacency(proteinNames.size(), edges, true);
+
+  PSMsToProteins.names = Array<string>(PSMNames);
+  PSMsToProteins.weights = Array<double>(PSMWeights);
+  PSMsToProteins.sections = Array<int>(PSMAdjacency.size(), -1);
+  PSMsToProteins.associations = Array<Set>(PSMAdjacency.size());
+  int k;
+  for (k=0; k<PSMAdjacency.size(); k++)
+    PSMsToProteins.associations[k] = PSMAdjacency.row(k);
+
+  proteinsToPSMs.names = Array<string>(proteinNames);
+  proteinsToPSMs.weights = Array<double>(proteinAdjacency.size(), -1.0);
+  proteinsToPSMs.sections = Array<int>(proteinAdjacency.size(), -1);
+  proteinsToPSMs.associations = Array<Set>(proteinAdjacency.size());
+  for (k=0; k<proteinAdjacency.size(); k++)
+    proteinsToPSMs.associations[k] = proteinAdjacency.row(k);
+}
+
 void BasicBigraph::printGraphStats() const
 {
   cout << "There are \t" << PSMsToProteins.size() << " PSMs" << endl;
@@ -382,30 +583,6 @@ void BasicBigraph::disconnectProtein(int k)
   as = Set();
 }
 
-void BasicBigraph::add(GraphLayer & gl, StringTable & st, const string & item)
-{
-  if ( st.lookup(item) == -1 )
-    {
-      // if the string is not already known, then add a new node for it
-      st.add(item);
-      gl.associations.add( Set() );
-      gl.weights.add( -1.0 );
-      gl.sections.add(-1);
-    }
-}
-
-void BasicBigraph::connect(const StringTable & pepNames, const string & pepName, const StringTable & proteinNames, const string & protName)
-{
-  int pepIndex = pepNames.lookup(pepName);
-  int protIndex = proteinNames.lookup(protName);
-
-  // performance note: currently O(n^2) worstcase. Later use a bitset
-  // and then after the graph is read, pack it into a set. 
-
-  PSMsToProteins.associations[ pepIndex ] |= Set::SingletonSet(protIndex);
-  proteinsToPSMs.associations[ protIndex ] |= Set::SingletonSet(pepIndex);
-}
-
 void BasicBigraph::printProteinWeights() const
 {
   const Array<string> & protNames = proteinsToPSMs.names;
@@ -418,33 +595,23 @@ void BasicBigraph::printProteinWeights() const
     }
 }
 
-void BasicBigraph::traceConnected(int index, GraphLayer & gl, int sectionNumber)
+int BasicBigraph::markSectionPartitions()
 {
-  if ( gl.sections[index] == sectionNumber )
-    return;
-  gl.sections[index] = sectionNumber;
-  // if it has not already been marked by this section, do so
-  gl.sectionMarks[index] |= Set::SingletonSet(sectionNumber);
-  if ( & gl == & PSMsToProteins && gl.weights[index] <= PeptideThreshold )
-    {
-      return;
-    }
+  // returns the number of sections that are found
 
-  const Set & as = gl.associations[index];
-  for (Set::Iterator iter = as.begin(); iter != as.end(); iter++)
+  // proteins share a section when a path through PSMs scoring above
+  // PeptideThreshold joins them; the PSMs at or below the threshold do
+  // not join sections, and are marked by every section they touch
+  int k, j;
+  UnionFind components(proteinsToPSMs.size());
+  for (k=0; k<PSMsToProteins.size(); k++)
     {
-      if ( & gl == & proteinsToPSMs )
-	traceConnected( *iter, PSMsToProteins, sectionNumber );
-      else
-	{
-	  traceConnected( *iter, proteinsToPSMs, sectionNumber );
-	}
+      const Set & as = PSMsToProteins.associations[k];
+      if ( PSMsToProteins.weights[k] <= PeptideThreshold )
+	continue;
+      for (j=1; j<as.size(); j++)
+	components.unite( as[0], as[j] );
     }
-}
-
-int BasicBigraph::markSectionPartitions()
-{
-  // returns the number of sections that are found
 
   proteinsToPSMs.sectionMarks = Array<Set>(proteinsToPSMs.size());
   PSMsToProteins.sectionMarks = Array<Set>(PSMsToProteins.size());
@@ -452,15 +619,30 @@ int BasicBigraph::markSectionPartitions()
   PSMsToProteins.sections = Array<int>(PSMsToProteins.size(), -1);
   proteinsToPSMs.sections = Array<int>(proteinsToPSMs.size(), -1);
 
+  // sections are numbered in the order of their first protein
+  Array<int> sectionOfRoot(proteinsToPSMs.size(), -1);
   int section = 0;
-  int k;
   for (k=0; k<proteinsToPSMs.size(); k++)
     {
-      if ( proteinsToPSMs[k].section == -1 )
+      int root = components.find(k);
+      if ( sectionOfRoot[root] == -1 )
 	{
-	  traceConnected( k, proteinsToPSMs, section );
+	  sectionOfRoot[root] = section;
 	  section++;
 	}
+      proteinsToPSMs.sections[k] = sectionOfRoot[root];
+      proteinsToPSMs.sectionMarks[k] = Set::SingletonSet( sectionOfRoot[root] );
+    }
+
+  for (k=0; k<PSMsToProteins.size(); k++)
+    {
+      const Set & as = PSMsToProteins.associations[k];
+      Set & marks = PSMsToProteins.sectionMarks[k];
+      for (j=0; j<as.size(); j++)
+	marks |= Set::SingletonSet( proteinsToPSMs.sections[ as[j] ] );
+      // a PSM marked by several sections belongs to the last of them
+      if ( ! marks.isEmpty() )
+	PSMsToProteins.sections[k] = marks.back();
     }
 
   return section;
@@ -470,24 +652,52 @@ Array<BasicBigraph> BasicBigraph::partitionSections()
 {
   int numSections = markSectionPartitions();
 
-  Array<Set> proteinSubsets(numSections), PSMSubsets(numSections);
-  int k;
+  // number the nodes within their sections, so that every subgraph is
+  // filled in one pass over the nodes instead of searching the
+  // section subsets for every association
+  Array<int> proteinLocal(proteinsToPSMs.size()), PSMLocal(PSMsToProteins.size());
+  Array<int> proteinCounts(numSections, 0), PSMCounts(numSections, 0);
+  int k, j;
   for (k=0; k<proteinsToPSMs.size(); k++)
-    {
-      proteinSubsets[ proteinsToPSMs[k].section ].add(k);
-    }
-
+    proteinLocal[k] = proteinCounts[ proteinsToPSMs.sections[k] ]++;
   for (k=0; k<PSMsToProteins.size(); k++)
+    PSMLocal[k] = PSMCounts[ PSMsToProteins.sections[k] ]++;
+
+  Array<BasicBigraph> result(numSections);
+  for (k=0; k<proteinsToPSMs.size(); k++)
     {
-      PSMSubsets[ PSMsToProteins[k].section ].add(k);
+      int sect = proteinsToPSMs.sections[k];
+      GraphLayer & gl = result[sect].proteinsToPSMs;
+      const Set & as = proteinsToPSMs.associations[k];
+      Set reindexed;
+      for (j=0; j<as.size(); j++)
+	{
+	  if ( PSMsToProteins.sections[ as[j] ] != sect )
+	    throw Set::InvalidBaseException();
+	  reindexed.add( PSMLocal[ as[j] ] );
+	}
+      gl.names.add( proteinsToPSMs.names[k] );
+      gl.associations.add( reindexed );
+      gl.weights.add( proteinsToPSMs.weights[k] );
+      gl.sections.add( sect );
     }
 
-  // now reindex them to their proper sets
-
-  Array<BasicBigraph> result;
-  for (k=0; k<numSections; k++)
+  for (k=0; k<PSMsToProteins.size(); k++)
     {
-      result.add( buildSubgraph( proteinSubsets[k], PSMSubsets[k] ) );
+      int sect = PSMsToProteins.sections[k];
+      GraphLayer & gl = result[sect].PSMsToProteins;
+      const Set & as = PSMsToProteins.associations[k];
+      Set reindexed;
+      for (j=0; j<as.size(); j++)
+	{
+	  if ( proteinsToPSMs.sections[ as[j] ] != sect )
+	    throw Set::InvalidBaseException();
+	  reindexed.add( proteinLocal[ as[j] ] );
+	}
+      gl.names.add( PSMsToProteins.names[k] );
+      gl.associations.add( reindexed );
+      gl.weights.add( PSMsToProteins.weights[k] );
+      gl.sections.add( sect );
     }
 
   return result;
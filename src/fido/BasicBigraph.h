@@ -2,8 +2,10 @@
 #define _BasicBigraph_H
 
 #include <fstream>
+#include <boost/unordered_map.hpp>
 #include "Scores.h"
 #include "StringTable.h"
+#include "CSRGraph.h"
 #include "Array.h"
 #include "Vector.h"
 
@@ -55,6 +57,18 @@ struct GraphLayer
   {
     return associations.size();
   }
+  // approximate number of bytes held by the layer
+  size_t getMemoryUsage() const
+  {
+    size_t bytes = weights.size() * sizeof(double) + sections.size() * sizeof(int);
+    for (int k=0; k<names.size(); k++)
+      bytes += sizeof(string) + names[k].size();
+    for (int k=0; k<associations.size(); k++)
+      bytes += sizeof(Set) + associations[k].size() * sizeof(int);
+    for (int k=0; k<sectionMarks.size(); k++)
+      bytes += sizeof(Set) + sectionMarks[k].size() * sizeof(int);
+    return bytes;
+  }
 };
 
 class BasicBigraph 
@@ -69,10 +83,18 @@ public:
   
   void read(Scores* fullset, bool multiple_labeled_peptides = false);
   void read(istream & is, bool multiple_labeled_peptides = false);
+  // binary dump of the graph as read, before pruning: the names, the PSM
+  // weights and the PSM to protein adjacency, in the byte order of the
+  // machine that wrote it
+  void writeBinary(ostream & os) const;
+  void readBinary(istream & is);
+  // true if the seekable stream holds a binary dump, which is left in place
+  static bool isBinary(istream & is);
   void prune();
   void printGraph();
   void printProteinWeights() const;
   void printGraphStats() const;
+  virtual size_t getMemoryUsage() const;
   void print() const
   {
     cout << "PSM graph layer: " << endl;
@@ -94,9 +116,10 @@ public:
   
 protected:
   
-  void add(GraphLayer & gl, StringTable & st, const string & item);
-  void connect(const StringTable & PSMNames, const string & pepStr, 
-	       const StringTable & proteinNames, const string & protStr);
+  typedef boost::unordered_map<string, int> NameIndex;
+  static int lookupOrAdd(NameIndex & index, vector<string> & names, const string & name);
+  void buildLayers(const vector<string> & PSMNames, const vector<double> & PSMWeights,
+		   const vector<string> & proteinNames, const vector<pair<int,int> > & edges);
   void disconnectProtein(int k);
   void disconnectPSM(int k);
   void pseudoCountPSMs();
@@ -112,7 +135,6 @@ protected:
   void saveSeveredProteins();
   
   BasicBigraph buildSubgraph(const Set & connectedProteins, const Set & connectedPSMs);
-  void traceConnected(int index, GraphLayer & gl, int sectionNumber);
   
   double ProteinThreshold;
   double PeptideThreshold;
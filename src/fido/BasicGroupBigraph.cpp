@@ -2,12 +2,23 @@
 // see license for more information
 
 #include "BasicGroupBigraph.h"
+#include "RandomStream.h"
 
 BasicGroupBigraph::~BasicGroupBigraph()
 {
 
 }
 
+size_t BasicGroupBigraph::getMemoryUsage() const
+{
+  size_t bytes = BasicBigraph::getMemoryUsage() + sizeof(BasicGroupBigraph) - sizeof(BasicBigraph);
+  bytes += originalN.size() * sizeof(Counter) + probabilityR.size() * sizeof(double);
+  for (int k=0; k<groupProtNames.size(); k++)
+    for (int j=0; j<groupProtNames[k].size(); j++)
+      bytes += sizeof(string) + groupProtNames[k][j].size();
+  return bytes;
+}
+
 
 void BasicGroupBigraph::printProteinWeights() const
 {
@@ -163,7 +174,7 @@ double BasicGroupBigraph::likelihoodNGivenD(const Model & m, const Array<Counter
 
 double BasicGroupBigraph::logLikelihoodNGivenD(const Model & m, const Array<Counter> & n) const
 {
-  double logProd = 0.0;
+  vector<double> terms(PSMsToProteins.size());
 
   for (int k=0; k<PSMsToProteins.size(); k++)
     {
@@ -172,11 +183,15 @@ double BasicGroupBigraph::logLikelihoodNGivenD(const Model & m, const Array<Coun
       double probE = PeptidePrior;
       double termE = probEGivenD / probE * probEGivenN;
       double termNotE = (1-probEGivenD) / (1-probE) * (1-probEGivenN);
-      double term = termE + termNotE;
-      
-      logProd += log2(term);
+      terms[k] = termE + termNotE;
     }
 
+  double logProd = 0.0;
+  if ( terms.size() > 0 )
+    Numerical::log2Batch(& terms[0], & terms[0], terms.size());
+  for (unsigned int k=0; k<terms.size(); k++)
+    logProd += terms[k];
+
   return logProd;
 }
 
@@ -212,34 +227,266 @@ double BasicGroupBigraph::probabilityNNu(const Model & m, const Counter & nNu) c
 double BasicGroupBigraph::probabilityNGivenD(const Model & m, const Array<Counter> & n) const
 {
   double logLike= logLikelihoodNGivenD(m,n) + log2(probabilityN(m,n)) - logLikelihoodConstantCachedFunctor(m,this);
-  return pow(2.0, logLike);
+  return exp2(logLike);
 }
 
 double BasicGroupBigraph::logLikelihoodConstant(const Model & m) const
 {
-  double result = 0.0;
-  bool starting = true;
+  ConfigurationSums sums;
+  sweepConfigurations(m, sums, false);
+  return combineConfigurationSums(sums, m.gamma, NULL);
+}
 
-  Array<Counter> n = originalN;
+// adds a log2 term to a sum, keeping the terms that are -inf in a separate
+// count so that they can be removed again without producing nan
+static inline void addLogTerm(double term, double & sum, int & numberInfinite)
+{
+  if ( isinf(term) )
+    numberInfinite++;
+  else
+    sum += term;
+}
 
-  for (Counter::start(n); Counter::inRange(n); Counter::advance(n))
+static inline void removeLogTerm(double term, double & sum, int & numberInfinite)
+{
+  if ( isinf(term) )
+    numberInfinite--;
+  else
+    sum -= term;
+}
+
+void BasicGroupBigraph::sweepConfigurations(const Model & m, ConfigurationSums & sums, bool withStates) const
+{
+  int numberGroups = originalN.size();
+  int numberPSMs = PSMsToProteins.size();
+
+  // log2 of the number of ways to pick the active proteins of each group;
+  // the rest of the prior is applied per total in combineConfigurationSums
+  int totalProteins = 0;
+  vector<vector<double> > logWays(numberGroups);
+  for (int k=0; k<numberGroups; k++)
+    {
+      int size = originalN[k].size;
+      totalProteins += size;
+      for (int active=0; active<=size; active++)
+	logWays[k].push_back( Combinatorics::logBinomial(size, active) );
+    }
+
+  vector<vector<double> > logTerm(numberPSMs);
+  logTermTable(m, logTerm);
+
+  vector<vector<int> > adjacentPSMs(numberGroups);
+  for (int k=0; k<numberGroups; k++)
     {
-      double L = logLikelihoodNGivenD(m, n);
-      double p = log2(probabilityN(m, n));
-      double logLikeTerm = L+p;
+      const Set & s = proteinsToPSMs.associations[k];
+      for (int j=0; j<s.size(); j++)
+	adjacentPSMs[k].push_back(s[j]);
+    }
 
-      if ( starting )
+  // state of the sweep: the configuration, its number of active proteins,
+  // the number of active proteins adjacent to each PSM, the log likelihood
+  // of the configuration and its log number of ways
+  vector<int> state(numberGroups, 0), active(numberPSMs, 0);
+  int activeProteins = 0;
+  double logLikelihood = 0.0, logWaysSum = 0.0;
+  int numberInfinite = 0;
+  for (int k=0; k<numberPSMs; k++)
+    addLogTerm(logTerm[k][0], logLikelihood, numberInfinite);
+  for (int k=0; k<numberGroups; k++)
+    logWaysSum += logWays[k][0];
+
+  // the sums are kept relative to the largest term seen so far, so that
+  // no pass is needed to find the constant before the weights are known
+  sums.logReference.assign(totalProteins+1, -Numerical::inf());
+  sums.total.assign(totalProteins+1, 0.0);
+  sums.weightedState.assign(withStates ? totalProteins+1 : 0, vector<double>(numberGroups, 0.0));
+
+  // the log terms of the configurations are collected in blocks and
+  // exponentiated together, which keeps the exp2 calls out of the steps
+  // of the sweep
+  ConfigurationBlock block;
+  block.logTerm.reserve(ConfigurationBlock::size);
+  block.activeProteins.reserve(ConfigurationBlock::size);
+  if ( withStates )
+    block.state.reserve(ConfigurationBlock::size * numberGroups);
+
+  // focus pointers and directions of the loopless reflected mixed radix
+  // Gray code (Knuth, TAOCP 7.2.1.1, algorithm H)
+  vector<int> focus(numberGroups+1), direction(numberGroups, 1);
+  for (int k=0; k<=numberGroups; k++)
+    focus[k] = k;
+
+  const unsigned int resyncInterval = 1024;
+  for (unsigned int step = 1; ; step++)
+    {
+      if ( numberInfinite == 0 )
 	{
-	  starting = false;
-	  result = logLikeTerm;
+	  block.logTerm.push_back(logLikelihood + logWaysSum);
+	  block.activeProteins.push_back(activeProteins);
+	  if ( withStates )
+	    block.state.insert(block.state.end(), state.begin(), state.end());
+	  if ( int(block.logTerm.size()) == ConfigurationBlock::size )
+	    addConfigurationBlock(block, sums);
 	}
-      else
+
+      int j = focus[0];
+      focus[0] = 0;
+      if ( j == numberGroups )
+	break;
+
+      // move group j one step and update the PSMs it is adjacent to
+      int delta = direction[j];
+      logWaysSum -= logWays[j][ state[j] ];
+      state[j] += delta;
+      logWaysSum += logWays[j][ state[j] ];
+      activeProteins += delta;
+      const vector<int> & psms = adjacentPSMs[j];
+      for (unsigned int k=0; k<psms.size(); k++)
+	{
+	  int e = psms[k];
+	  removeLogTerm(logTerm[e][ active[e] ], logLikelihood, numberInfinite);
+	  active[e] += delta;
+	  addLogTerm(logTerm[e][ active[e] ], logLikelihood, numberInfinite);
+	}
+
+      if ( state[j] == 0 || state[j] == originalN[j].size )
+	{
+	  direction[j] = -direction[j];
+	  focus[j] = focus[j+1];
+	  focus[j+1] = j+1;
+	}
+
+      // recompute the sum now and then, so that the rounding errors of the
+      // incremental updates do not accumulate
+      if ( step % resyncInterval == 0 )
 	{
-	  result = Numerical::logAdd(result, logLikeTerm);
+	  logLikelihood = 0.0;
+	  numberInfinite = 0;
+	  for (int k=0; k<numberPSMs; k++)
+	    addLogTerm(logTerm[k][ active[k] ], logLikelihood, numberInfinite);
+	  logWaysSum = 0.0;
+	  for (int k=0; k<numberGroups; k++)
+	    logWaysSum += logWays[k][ state[k] ];
 	}
     }
+  addConfigurationBlock(block, sums);
+}
 
-  return result;
+void BasicGroupBigraph::addConfigurationBlock(ConfigurationBlock & block, ConfigurationSums & sums) const
+{
+  int numberConfigurations = block.logTerm.size();
+  int numberGroups = originalN.size();
+  bool withStates = ! block.state.empty();
+  int k, j;
+
+  // raise the reference of every total to the largest term of the block
+  // first, so that every weight of the block is at most 1
+  for (k=0; k<numberConfigurations; k++)
+    {
+      int activeProteins = block.activeProteins[k];
+      double & logReference = sums.logReference[activeProteins];
+      if ( block.logTerm[k] > logReference )
+	{
+	  double scale = ( isinf(logReference) ? 0.0 : ::exp2(logReference - block.logTerm[k]) );
+	  sums.total[activeProteins] *= scale;
+	  if ( withStates )
+	    for (j=0; j<numberGroups; j++)
+	      sums.weightedState[activeProteins][j] *= scale;
+	  logReference = block.logTerm[k];
+	}
+    }
+
+  for (k=0; k<numberConfigurations; k++)
+    block.logTerm[k] -= sums.logReference[ block.activeProteins[k] ];
+  vector<double> & weight = block.logTerm;
+  if ( numberConfigurations > 0 )
+    Numerical::exp2Batch(& weight[0], & weight[0], numberConfigurations);
+
+  for (k=0; k<numberConfigurations; k++)
+    {
+      int activeProteins = block.activeProteins[k];
+      sums.total[activeProteins] += weight[k];
+      if ( withStates )
+	{
+	  // a plain multiply-add over contiguous rows, the division by the
+	  // group sizes is left to combineConfigurationSums
+	  const double * state = & block.state[ k * numberGroups ];
+	  double * weightedState = & sums.weightedState[activeProteins][0];
+	  for (j=0; j<numberGroups; j++)
+	    weightedState[j] += weight[k] * state[j];
+	}
+    }
+
+  block.logTerm.clear();
+  block.activeProteins.clear();
+  block.state.clear();
+}
+
+void BasicGroupBigraph::logTermTable(const Model & m, vector<vector<double> > & logTerm) const
+{
+  // log2 of the likelihood term of each PSM for every number of active
+  // associated proteins
+  for (int k=0; k<PSMsToProteins.size(); k++)
+    {
+      double probEGivenD = PSMsToProteins.weights[k];
+      double probE = PeptidePrior;
+      int total = numberAssociatedProteins(k);
+      vector<double> & terms = logTerm[k];
+      terms.resize(total+1);
+      for (int active=0; active<=total; active++)
+	{
+	  double probEGivenN = probabilityEEpsilonGivenActiveAssociatedProteins(m, active);
+	  double termE = probEGivenD / probE * probEGivenN;
+	  double termNotE = (1-probEGivenD) / (1-probE) * (1-probEGivenN);
+	  terms[active] = termE + termNotE;
+	}
+      Numerical::log2Batch(& terms[0], & terms[0], total+1);
+    }
+}
+
+
+double BasicGroupBigraph::combineConfigurationSums(const ConfigurationSums & sums, double gamma, Array<double> * probR) const
+{
+  int numberGroups = originalN.size();
+  int totalProteins = sums.total.size() - 1;
+
+  // log2 of the weight of each total, with the gamma part of the prior
+  vector<double> logWeight(totalProteins+1, -Numerical::inf());
+  double logReference = -Numerical::inf();
+  for (int activeProteins=0; activeProteins<=totalProteins; activeProteins++)
+    {
+      if ( sums.total[activeProteins] <= 0.0 )
+	continue;
+      double logPrior = 0.0;
+      if ( activeProteins > 0 )
+	logPrior += activeProteins * log2(gamma);
+      if ( activeProteins < totalProteins )
+	logPrior += (totalProteins-activeProteins) * log2(1-gamma);
+      logWeight[activeProteins] = sums.logReference[activeProteins] + logPrior;
+      logReference = max(logReference, logWeight[activeProteins] + log2(sums.total[activeProteins]));
+    }
+
+  double total = 0.0;
+  vector<double> weightedState(numberGroups, 0.0);
+  for (int activeProteins=0; activeProteins<=totalProteins; activeProteins++)
+    {
+      if ( isinf(logWeight[activeProteins]) )
+	continue;
+      double scale = ::exp2(logWeight[activeProteins] - logReference);
+      total += scale * sums.total[activeProteins];
+      if ( probR != NULL )
+	for (int k=0; k<numberGroups; k++)
+	  weightedState[k] += scale * sums.weightedState[activeProteins][k];
+    }
+
+  if ( probR != NULL )
+    {
+      *probR = Array<double>(numberGroups);
+      for (int k=0; k<numberGroups; k++)
+	(*probR)[k] = weightedState[k] / total / originalN[k].size;
+    }
+
+  return logReference + log2(total);
 }
 
 double BasicGroupBigraph::likelihoodConstant(const Model & m) const
@@ -326,7 +573,7 @@ Array<double> BasicGroupBigraph::probabilityRGivenD(const Model & m)
   return result.unpack();
 }
 
-Array<double> BasicGroupBigraph::probabilityRGivenN(const Array<Counter> & n)
+Array<double> BasicGroupBigraph::probabilityRGivenN(const Array<Counter> & n) const
 {
   Array<double> result(n.size());
 
@@ -338,7 +585,7 @@ Array<double> BasicGroupBigraph::probabilityRGivenN(const Array<Counter> & n)
   return result;
 }
 
-double BasicGroupBigraph::probabilityRRhoGivenN(int indexRho, const Array<Counter> & n)
+double BasicGroupBigraph::probabilityRRhoGivenN(int indexRho, const Array<Counter> & n) const
 {
   const Counter & c = n[indexRho];
 
@@ -347,7 +594,136 @@ double BasicGroupBigraph::probabilityRRhoGivenN(int indexRho, const Array<Counte
 
 void BasicGroupBigraph::getProteinProbs(const Model & m)
 {
-  probabilityR = probabilityRGivenD(m);
+  if ( isApproximate() )
+    {
+      probabilityR = gibbsProteinProbs(m, gibbsSweeps, gibbsStream);
+      return;
+    }
+  // the constant and the probabilities come out of the same sweep
+  ConfigurationSums sums;
+  sweepConfigurations(m, sums, true);
+  combineConfigurationSums(sums, m.gamma, & probabilityR);
+}
+
+Array<double> BasicGroupBigraph::computeProteinProbs(const Model & m) const
+{
+  if ( isApproximate() )
+    return gibbsProteinProbs(m, gibbsSweeps, gibbsStream);
+  ConfigurationSums sums;
+  sweepConfigurations(m, sums, true);
+  Array<double> result;
+  combineConfigurationSums(sums, m.gamma, & result);
+  return result;
+}
+
+void BasicGroupBigraph::computeProteinProbs(double alpha, double beta, const vector<double> & gammas, vector<Array<double> > & probs) const
+{
+  if ( isApproximate() )
+    {
+      probs.resize(gammas.size());
+      for (unsigned int k=0; k<gammas.size(); k++)
+	probs[k] = gibbsProteinProbs(Model(alpha, beta, gammas[k]), gibbsSweeps, gibbsStream);
+      return;
+    }
+  ConfigurationSums sums;
+  sweepConfigurations(Model(alpha, beta, -1), sums, true);
+  probs.resize(gammas.size());
+  for (unsigned int k=0; k<gammas.size(); k++)
+    combineConfigurationSums(sums, gammas[k], & probs[k]);
+}
+
+Array<double> BasicGroupBigraph::gibbsProteinProbs(const Model & m, unsigned int sweeps, unsigned int stream) const
+{
+  int numberGroups = originalN.size();
+  int numberPSMs = PSMsToProteins.size();
+
+  // the same tables as in sweepConfigurations, but with the full prior
+  vector<vector<double> > logPrior(numberGroups);
+  for (int k=0; k<numberGroups; k++)
+    {
+      Counter c = originalN[k];
+      for (c.start(); c.inRange(); c.state++)
+	logPrior[k].push_back( log2(probabilityNNu(m, c)) );
+    }
+
+  vector<vector<double> > logTerm(numberPSMs);
+  logTermTable(m, logTerm);
+
+  // the sampler is restarted from the same stream for every model, so that
+  // the estimates do not depend on the order the models are evaluated in
+  RandomStream rnd(RandomStream::FIDO_GIBBS, stream);
+  vector<int> state(numberGroups, 0), active(numberPSMs, 0);
+  vector<double> expectedState(numberGroups, 0.0);
+  // a conditional that is zero everywhere is skipped, so each group keeps
+  // its own number of accumulated sweeps
+  vector<unsigned int> samples(numberGroups, 0);
+  vector<double> logWeight, weight;
+  unsigned int burnIn = max(1u, sweeps / 5);
+
+  for (unsigned int sweep = 0; sweep < burnIn + sweeps; sweep++)
+    {
+      for (int k=0; k<numberGroups; k++)
+	{
+	  // conditional distribution of the active count of group k
+	  const Set & psms = proteinsToPSMs.associations[k];
+	  int size = originalN[k].size;
+	  logWeight.assign(size+1, 0.0);
+	  double largest = -Numerical::inf();
+	  for (int s=0; s<=size; s++)
+	    {
+	      logWeight[s] = logPrior[k][s];
+	      for (int j=0; j<psms.size(); j++)
+		logWeight[s] += logTerm[ psms[j] ][ active[psms[j]] - state[k] + s ];
+	      largest = max(largest, logWeight[s]);
+	    }
+	  if ( isinf(largest) )
+	    continue;
+
+	  weight.resize(size+1);
+	  for (int s=0; s<=size; s++)
+	    weight[s] = logWeight[s] - largest;
+	  Numerical::exp2Batch(& weight[0], & weight[0], size+1);
+	  double total = 0.0;
+	  for (int s=0; s<=size; s++)
+	    total += weight[s];
+
+	  // average the conditional expectation rather than the draws, it
+	  // has a lower variance
+	  if ( sweep >= burnIn )
+	    {
+	      double expected = 0.0;
+	      for (int s=1; s<=size; s++)
+		expected += weight[s] * s;
+	      expectedState[k] += expected / total / size;
+	      samples[k]++;
+	    }
+
+	  double u = rnd.uniform() * total;
+	  int next = 0;
+	  while ( next < size && u >= weight[next] )
+	    {
+	      u -= weight[next];
+	      next++;
+	    }
+	  int delta = next - state[k];
+	  if ( delta != 0 )
+	    {
+	      state[k] = next;
+	      for (int j=0; j<psms.size(); j++)
+		active[ psms[j] ] += delta;
+	    }
+	}
+    }
+
+  Array<double> result(numberGroups);
+  for (int k=0; k<numberGroups; k++)
+    {
+      if ( samples[k] > 0 )
+	result[k] = expectedState[k] / samples[k];
+      else
+	result[k] = double(state[k]) / originalN[k].size;
+    }
+  return result;
 }
 
 double BasicGroupBigraph::probabilityEEpsilonOverAllAlphaBeta(const GridModel & gm, int indexEpsilon) const
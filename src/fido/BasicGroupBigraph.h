@@ -88,6 +88,30 @@ class Counter
 };
 
 
+// sums over all configurations of a group graph for one alpha and beta,
+// split by the total number of active proteins. The prior depends on gamma
+// only through that number, so the posteriors for any gamma follow from
+// these sums without enumerating the configurations again
+struct ConfigurationSums
+{
+  // per number of active proteins: the largest log2 term seen, the sum of
+  // the terms relative to it and the same sum weighted by the number of
+  // active proteins of each group
+  vector<double> logReference;
+  vector<double> total;
+  vector<vector<double> > weightedState;
+};
+
+// configurations of a sweep that wait to be added to the sums: their log2
+// terms, numbers of active proteins and, if needed, their states
+struct ConfigurationBlock
+{
+  static const int size = 512;
+  vector<double> logTerm;
+  vector<int> activeProteins;
+  vector<double> state;
+};
+
 class BasicGroupBigraph : public BasicBigraph
 {
 
@@ -96,14 +120,16 @@ class BasicGroupBigraph : public BasicBigraph
    
   BasicGroupBigraph(bool __nogroupProtein = false, bool __trivialGrouping = false) :
     logLikelihoodConstantCachedFunctor( & BasicGroupBigraph::logLikelihoodConstant, "logLikelihoodConstant"),
-    nogroupProtein(__nogroupProtein),trivialGrouping(__trivialGrouping)
+    nogroupProtein(__nogroupProtein),trivialGrouping(__trivialGrouping),
+    gibbsSweeps(0),gibbsStream(0)
   {
   }
 
   BasicGroupBigraph(const BasicBigraph & rhs,bool __nogroupProtein = false, bool __trivialGrouping = false) :
   BasicBigraph(rhs),   
   logLikelihoodConstantCachedFunctor( & BasicGroupBigraph::logLikelihoodConstant, "logLikelihoodConstant"),
-  nogroupProtein(__nogroupProtein),trivialGrouping(__trivialGrouping)
+  nogroupProtein(__nogroupProtein),trivialGrouping(__trivialGrouping),
+  gibbsSweeps(0),gibbsStream(0)
   {
     if(nogroupProtein)
       trivialGroupProteins();
@@ -129,7 +155,15 @@ class BasicGroupBigraph : public BasicBigraph
   }
   
   double logNumberOfConfigurations() const;
+  size_t getMemoryUsage() const;
   void getProteinProbs(const Model & m);
+  // same as getProteinProbs, but returns the probabilities instead of
+  // storing them and does not use the cache, so that several models can
+  // be evaluated on the same graph concurrently
+  Array<double> computeProteinProbs(const Model & m) const;
+  // the probabilities for alpha, beta and each of the gammas, from a
+  // single enumeration of the configurations
+  void computeProteinProbs(double alpha, double beta, const vector<double> & gammas, vector<Array<double> > & probs) const;
   void printProteinWeights() const;
 
   const Array<double> & proteinProbabilities() const
@@ -146,6 +180,23 @@ class BasicGroupBigraph : public BasicBigraph
     return originalN;
   }
 
+  // makes getProteinProbs estimate the probabilities with a Gibbs sampler
+  // of the given number of sweeps instead of enumerating all configurations,
+  // for graphs that are too large to enumerate. The sampler draws from the
+  // random stream with the given index, 0 sweeps enumerates again
+  void setGibbsSampling(unsigned int sweeps, unsigned int stream)
+  {
+    gibbsSweeps = sweeps;
+    gibbsStream = stream;
+  }
+  bool isApproximate() const
+  {
+    return gibbsSweeps > 0;
+  }
+  // Gibbs sampler over the active count of each group. Its cost per sweep
+  // grows linearly with the number of edges
+  Array<double> gibbsProteinProbs(const Model & m, unsigned int sweeps, unsigned int stream) const;
+
 private:
   
   Array<Counter> originalN;
@@ -153,6 +204,8 @@ private:
   Array<double> probabilityR;
   bool nogroupProtein;
   bool trivialGrouping;
+  unsigned int gibbsSweeps;
+  unsigned int gibbsStream;
  
   // protected construction functions
   void groupProteins();
@@ -178,11 +231,24 @@ private:
   double probabilityNGivenD(const Model & m, const Array<Counter> & n) const;
 
   double logLikelihoodConstant(const Model & m) const;
+  // visits every configuration once in reflected Gray code order, so that
+  // each step changes the active count of a single group by one and only
+  // the PSMs adjacent to that group need their likelihood terms updated.
+  // The gamma of m is not used; the weighted states are only summed if
+  // withStates is set
+  void sweepConfigurations(const Model & m, ConfigurationSums & sums, bool withStates) const;
+  // returns log2 of the likelihood constant for gamma and, if probR is not
+  // NULL, stores the posterior probability of each group in it
+  double combineConfigurationSums(const ConfigurationSums & sums, double gamma, Array<double> * probR) const;
+  void addConfigurationBlock(ConfigurationBlock & block, ConfigurationSums & sums) const;
+  // log2 of the likelihood term of each PSM for every number of active
+  // associated proteins
+  void logTermTable(const Model & m, vector<vector<double> > & logTerm) const;
   double likelihoodConstant(const Model & m) const;
 
   Array<double> probabilityRGivenD(const Model & m);
-  Array<double> probabilityRGivenN(const Array<Counter> & n);
-  double probabilityRRhoGivenN(int indexRho, const Array<Counter> & n);
+  Array<double> probabilityRGivenN(const Array<Counter> & n) const;
+  double probabilityRRhoGivenN(int indexRho, const Array<Counter> & n) const;
 
   Array<double> probabilityEGivenD(const Model & m);
   Array<double> eCorrection(const Model & m, const Array<Counter> & n);
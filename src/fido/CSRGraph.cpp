@@ -0,0 +1,82 @@
+// see license for more information
+
+#include "CSRGraph.h"
+#include <algorithm>
+
+CSRAdjacency::CSRAdjacency(int numberRows, const vector<pair<int,int> > & edges, bool transpose):
+  offsets(numberRows+1, 0),
+  indices(edges.size())
+{
+  int k;
+  vector<pair<int,int> >::const_iterator iter;
+  for (iter = edges.begin(); iter != edges.end(); iter++)
+    {
+      int r = transpose ? iter->second : iter->first;
+      offsets[r+1]++;
+    }
+  for (k=0; k<numberRows; k++)
+    offsets[k+1] += offsets[k];
+
+  vector<int> fill(offsets.begin(), offsets.end()-1);
+  for (iter = edges.begin(); iter != edges.end(); iter++)
+    {
+      int r = transpose ? iter->second : iter->first;
+      int c = transpose ? iter->first : iter->second;
+      indices[ fill[r]++ ] = c;
+    }
+
+  // sort every row and squeeze out the repeated edges in place
+  int write = 0;
+  for (k=0; k<numberRows; k++)
+    {
+      vector<int>::iterator first = indices.begin() + offsets[k];
+      vector<int>::iterator last = indices.begin() + offsets[k+1];
+      sort(first, last);
+      last = unique(first, last);
+      offsets[k] = write;
+      for (; first != last; first++)
+	indices[write++] = *first;
+    }
+  offsets[numberRows] = write;
+  indices.resize(write);
+}
+
+Set CSRAdjacency::row(int k) const
+{
+  Set result;
+  for (int j=offsets[k]; j<offsets[k+1]; j++)
+    result.add( indices[j] );
+  return result;
+}
+
+UnionFind::UnionFind(int n):
+  parent(n),
+  rank(n, 0)
+{
+  for (int k=0; k<n; k++)
+    parent[k] = k;
+}
+
+int UnionFind::find(int k)
+{
+  // path halving keeps the trees flat without recursion
+  while ( parent[k] != k )
+    {
+      parent[k] = parent[ parent[k] ];
+      k = parent[k];
+    }
+  return k;
+}
+
+void UnionFind::unite(int a, int b)
+{
+  a = find(a);
+  b = find(b);
+  if ( a == b )
+    return;
+  if ( rank[a] < rank[b] )
+    swap(a, b);
+  parent[b] = a;
+  if ( rank[a] == rank[b] )
+    rank[a]++;
+}
@@ -0,0 +1,59 @@
+// see license for more information
+
+#ifndef _CSRGraph_H
+#define _CSRGraph_H
+
+#include <vector>
+#include <utility>
+#include "Set.h"
+
+using namespace std;
+
+// compressed sparse row adjacency: the neighbors of node k are
+// indices[ offsets[k] ] ... indices[ offsets[k+1]-1 ], sorted and
+// without duplicates
+class CSRAdjacency
+{
+ public:
+  CSRAdjacency() : offsets(1, 0) {}
+  // builds the rows of numberRows nodes from (row, column) pairs in
+  // one counting pass; with transpose the pairs are read as (column, row)
+  CSRAdjacency(int numberRows, const vector<pair<int,int> > & edges, bool transpose = false);
+
+  int size() const
+  {
+    return int(offsets.size()) - 1;
+  }
+  int numberEdges() const
+  {
+    return int(indices.size());
+  }
+  int degree(int k) const
+  {
+    return offsets[k+1] - offsets[k];
+  }
+  const int & neighbor(int k, int j) const
+  {
+    return indices[ offsets[k] + j ];
+  }
+  Set row(int k) const;
+
+ private:
+  vector<int> offsets;
+  vector<int> indices;
+};
+
+// disjoint sets over the indices 0 ... n-1
+class UnionFind
+{
+ public:
+  UnionFind(int n);
+  int find(int k);
+  void unite(int a, int b);
+
+ private:
+  vector<int> parent;
+  vector<int> rank;
+};
+
+#endif
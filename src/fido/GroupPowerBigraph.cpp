@@ -1,6 +1,7 @@
 // Written by Oliver Serang 2009
 // see license for more information
 
+#include <algorithm>
 #include "GroupPowerBigraph.h"
 
 GroupPowerBigraph::~GroupPowerBigraph()
@@ -8,13 +9,43 @@ GroupPowerBigraph::~GroupPowerBigraph()
 
 }
 
+size_t GroupPowerBigraph::getMemoryUsage() const
+{
+  size_t bytes = sizeof(GroupPowerBigraph) - sizeof(BasicBigraph) + fullGraph.getMemoryUsage() + probabilityR.size() * sizeof(double);
+  for (int k=0; k<subgraphs.size(); k++)
+    bytes += subgraphs[k].getMemoryUsage();
+  for (int k=0; k<severedProteins.size(); k++)
+    bytes += sizeof(string) + severedProteins[k].size();
+  for (int k=0; k<groupProtNames.size(); k++)
+    for (int j=0; j<groupProtNames[k].size(); j++)
+      bytes += sizeof(string) + groupProtNames[k][j].size();
+  return bytes;
+}
+
 Array<double> GroupPowerBigraph::proteinProbs()
 {
+  // the subgraphs are independent and their cost grows exponentially with
+  // their size, so the largest ones are handed out first and the threads
+  // that finish early pick up the small ones one at a time
+  int numSubgraphs = subgraphs.size();
+  vector<pair<double,int> > order(numSubgraphs);
+  for (int k=0; k<numSubgraphs; k++)
+    {
+      order[k] = make_pair(-subgraphs[k].logNumberOfConfigurations(), k);
+    }
+  sort(order.begin(), order.end());
+
+#pragma omp parallel for schedule(dynamic, 1)
+  for (int k=0; k<numSubgraphs; k++)
+    {
+      subgraphs[ order[k].second ].getProteinProbs(gm);
+    }
+
+  // collect in subgraph order, so that the result does not depend on the
+  // order the subgraphs were finished in
   Array<double> result;
-  
-  for (int k=0; k<subgraphs.size(); k++)
+  for (int k=0; k<numSubgraphs; k++)
     {
-      subgraphs[k].getProteinProbs(gm);
       result.append( subgraphs[k].proteinProbabilities() );
     }
 
@@ -26,9 +57,32 @@ void GroupPowerBigraph::getProteinProbs()
   probabilityR = proteinProbs();
 }
 
+void GroupPowerBigraph::getProteinProbs(double alpha, double beta, double gamma, Array<double> & proteinProbs) const
+{
+  Model m(alpha, beta, gamma);
+  proteinProbs = Array<double>();
+  for (int k=0; k<subgraphs.size(); k++)
+    {
+      proteinProbs.append( subgraphs[k].computeProteinProbs(m) );
+    }
+}
+
+void GroupPowerBigraph::getProteinProbs(double alpha, double beta, const vector<double> & gammas, vector<Array<double> > & proteinProbs) const
+{
+  proteinProbs.assign(gammas.size(), Array<double>());
+  vector<Array<double> > subgraphProbs;
+  for (int k=0; k<subgraphs.size(); k++)
+    {
+      subgraphs[k].computeProteinProbs(alpha, beta, gammas, subgraphProbs);
+      for (unsigned int j=0; j<gammas.size(); j++)
+	proteinProbs[j].append( subgraphProbs[j] );
+    }
+}
+
 void GroupPowerBigraph::getGroupProtNames()
 {
   int k,j;
+  groupProtNames = Array<Array<string> >();
   for (k=0; k<subgraphs.size(); k++)
     {
       const BasicGroupBigraph & bgb = subgraphs[k];
@@ -75,10 +129,15 @@ void GroupPowerBigraph::getProteinProbsPercolator(std::multimap<double, std::vec
 }
 
 void GroupPowerBigraph::getProteinProbsAndNames(std::vector<std::vector<std::string> > &names, std::vector<double> &probs) const
+{
+  getProteinProbsAndNames(probabilityR, names, probs);
+}
+
+void GroupPowerBigraph::getProteinProbsAndNames(const Array<double> & proteinProbs, std::vector<std::vector<std::string> > &names, std::vector<double> &probs) const
 {
   names.clear();
   probs.clear();
-  Array<double> sorted = probabilityR;
+  Array<double> sorted = proteinProbs;
   Array<int> indices = sorted.sort();
   for (int k=0; k<sorted.size(); k++)
   {
@@ -122,7 +181,12 @@ Array<BasicBigraph> GroupPowerBigraph::iterativePartitionSubgraphs(BasicBigraph
     {
       BasicGroupBigraph bgb = BasicGroupBigraph(preResult[k],nogroupProteins/*,trivialgruping*/);
       double logNumConfig = bgb.logNumberOfConfigurations();
-      if ( logNumConfig > LOG_MAX_ALLOWED_CONFIGURATIONS && 
+      if ( logNumConfig > LOG_MAX_ALLOWED_CONFIGURATIONS && gibbsSweeps > 0 )
+	{
+	  // keep the graph whole, it will be sampled instead of enumerated
+	  result.add( preResult[k] );
+	}
+      else if ( logNumConfig > LOG_MAX_ALLOWED_CONFIGURATIONS && 
 	log2(bgb.PSMsToProteins.size())+log2(bgb.getOriginalN()[0].size+1) <= LOG_MAX_ALLOWED_CONFIGURATIONS )
 	{
 	  double newThresh = 1.25*(newPeptideThreshold + 1e-6);
@@ -150,50 +214,46 @@ Array<BasicBigraph> GroupPowerBigraph::iterativePartitionSubgraphs(BasicBigraph
 
 void GroupPowerBigraph::read(Scores* fullset){
   
-  BasicBigraph bb;
-  bb.setPeptidePrior(PeptidePrior);
-  bb.setPeptideThreshold(PeptideThreshold);
-  bb.setPsmThreshold(PsmThreshold);
-  bb.setProteinThreshold(ProteinThreshold);
-  bb.read(fullset,multiple_labeled_peptides);
+  fullGraph = BasicBigraph();
+  fullGraph.read(fullset,multiple_labeled_peptides);
+  labeledFullGraph = multiple_labeled_peptides;
+  buildSubgraphs();
+}
 
-  if(!(bool)(noseparate))
-  {
-    severedProteins = Array<string>();
-    Array<BasicBigraph> subBasic;
-    subBasic = Array<BasicBigraph>();
-    
-    if(!(bool)(noprune))
-      subBasic = iterativePartitionSubgraphs(bb, PeptideThreshold);
-    else
-      subBasic = iterativePartitionSubgraphs(bb, -1);
+void GroupPowerBigraph::read(istream & is){
+  
+  fullGraph = BasicBigraph();
+  if ( BasicBigraph::isBinary(is) )
+    fullGraph.readBinary(is);
+  else
+    fullGraph.read(is,multiple_labeled_peptides);
+  // the file format has no decoy labels, any labeling gives this graph
+  labeledFullGraph = -1;
+  buildSubgraphs();
+}
 
-    subgraphs = Array<BasicGroupBigraph>(subBasic.size());
+void GroupPowerBigraph::writeBinary(ostream & os) const
+{
+  fullGraph.writeBinary(os);
+}
 
-    for (int k=0; k<subBasic.size(); k++)
-      {
-	subgraphs[k] = BasicGroupBigraph(subBasic[k],nogroupProteins,trivialgruping);
-      }
-  }
-  else
-  {
-    bb.prune();
-    severedProteins = Array<string>();
-    severedProteins.append( bb.severedProteins );
-    subgraphs = Array<BasicGroupBigraph>(1, BasicGroupBigraph(bb,nogroupProteins,trivialgruping));
-  }
-  
-  initialize();
+bool GroupPowerBigraph::rethreshold()
+{
+  if ( labeledFullGraph != -1 && labeledFullGraph != (int)multiple_labeled_peptides )
+    return false;
+  buildSubgraphs();
+  return true;
 }
 
-void GroupPowerBigraph::read(istream & is){
-  
-  BasicBigraph bb;
+void GroupPowerBigraph::buildSubgraphs()
+{
+  // the graph as read is kept untouched, the thresholds are applied to
+  // a copy of it
+  BasicBigraph bb = fullGraph;
   bb.setPeptidePrior(PeptidePrior);
   bb.setPeptideThreshold(PeptideThreshold);
   bb.setPsmThreshold(PsmThreshold);
   bb.setProteinThreshold(ProteinThreshold);
-  bb.read(is,multiple_labeled_peptides);
 
   if(!(bool)(noseparate))
   {
@@ -226,9 +286,56 @@ void GroupPowerBigraph::read(istream & is){
 
 void GroupPowerBigraph::initialize()
 {
+  setApproximateSubgraphs();
   getGroupProtNames();
 }
 
+void GroupPowerBigraph::setApproximateSubgraphs()
+{
+  for (int k=0; k<subgraphs.size(); k++)
+    {
+      if ( gibbsSweeps > 0 && subgraphs[k].logNumberOfConfigurations() > LOG_MAX_ALLOWED_CONFIGURATIONS )
+	subgraphs[k].setGibbsSampling(gibbsSweeps, k);
+      else
+	subgraphs[k].setGibbsSampling(0, k);
+    }
+}
+
+unsigned int GroupPowerBigraph::getNumberApproximateSubgraphs() const
+{
+  unsigned int count = 0;
+  for (int k=0; k<subgraphs.size(); k++)
+    {
+      if ( subgraphs[k].isApproximate() )
+	count++;
+    }
+  return count;
+}
+
+double GroupPowerBigraph::getApproximationError(unsigned int maxSubgraphs) const
+{
+  vector<pair<double,int> > exact;
+  for (int k=0; k<subgraphs.size(); k++)
+    {
+      if ( ! subgraphs[k].isApproximate() )
+	exact.push_back( make_pair(-subgraphs[k].logNumberOfConfigurations(), k) );
+    }
+  sort(exact.begin(), exact.end());
+  if ( exact.size() > maxSubgraphs )
+    exact.resize(maxSubgraphs);
+
+  double error = 0.0;
+  for (unsigned int i=0; i<exact.size(); i++)
+    {
+      const BasicGroupBigraph & bgb = subgraphs[ exact[i].second ];
+      Array<double> sampled = bgb.gibbsProteinProbs(gm, gibbsSweeps, exact[i].second);
+      Array<double> enumerated = bgb.computeProteinProbs(gm);
+      for (int j=0; j<sampled.size(); j++)
+	error = max(error, fabs(sampled[j] - enumerated[j]));
+    }
+  return error;
+}
+
 
 ostream & operator <<(ostream & os, pair<double,double> rhs)
 {
@@ -382,4 +489,14 @@ bool GroupPowerBigraph::getMultipleLabeledPeptides()
 void GroupPowerBigraph::setMultipleLabeledPeptides(bool __multiple_labeled_peptides)
 {
   multiple_labeled_peptides = __multiple_labeled_peptides;
-}
\ No newline at end of file
+}
+
+void GroupPowerBigraph::setGibbsSweeps(unsigned int sweeps)
+{
+  gibbsSweeps = sweeps;
+}
+
+unsigned int GroupPowerBigraph::getGibbsSweeps()
+{
+  return gibbsSweeps;
+}
@@ -31,7 +31,10 @@ public:
   PeptideThreshold(1e-3),
   ProteinThreshold(1e-3),
   PeptidePrior(0.1),
-  trivialgruping(__trivialGrouping)
+  trivialgruping(__trivialGrouping),
+  multiple_labeled_peptides(false),
+  labeledFullGraph(-1),
+  gibbsSweeps(0)
   {
     setAlphaBetaGamma(__alpha, __beta, __gamma);
   }
@@ -41,9 +44,17 @@ public:
   void printProteinWeights() const;
   void getProteinProbsPercolator(std::multimap<double, std::vector<std::string> > &pepProteins) const;
   void getProteinProbsAndNames(std::vector<std::vector<std::string> > &names, std::vector<double> &probs) const;
+  void getProteinProbsAndNames(const Array<double> & proteinProbs, std::vector<std::vector<std::string> > &names, std::vector<double> &probs) const;
   void getProteinProbs();
+  // computes the protein probabilities for the given parameters into
+  // proteinProbs, leaving the graph and its current parameters untouched
+  void getProteinProbs(double alpha, double beta, double gamma, Array<double> & proteinProbs) const;
+  // same for every gamma in gammas, enumerating each subgraph only once
+  void getProteinProbs(double alpha, double beta, const vector<double> & gammas, vector<Array<double> > & proteinProbs) const;
   Array<string> peptideNames() const;
   double getLogNumberStates() const;
+  // approximate number of bytes held by the graph and its subgraphs
+  size_t getMemoryUsage() const;
   pair<Array<Array<string> >, Array<double> > getDescendingProteinsAndWeights() const;
   void setAlphaBetaGamma(double alpha, double beta, double gamma);
   Array<std::string> getSeveredProteins();
@@ -67,14 +78,30 @@ public:
   void setSeparateProteins(bool __separateProteins);
   void setMultipleLabeledPeptides(bool __multiple_labeled_peptides);
   bool getMultipleLabeledPeptides();
+  // subgraphs that are too large to enumerate are kept whole and estimated
+  // with a Gibbs sampler of the given number of sweeps, instead of being
+  // pruned until they can be enumerated. 0 prunes them as before
+  void setGibbsSweeps(unsigned int sweeps);
+  unsigned int getGibbsSweeps();
+  unsigned int getNumberApproximateSubgraphs() const;
+  // the largest absolute difference between the sampler and the exact
+  // probabilities on up to maxSubgraphs of the largest enumerated subgraphs
+  double getApproximationError(unsigned int maxSubgraphs) const;
   void read(Scores* fullset);
+  // reads a graph file, or a binary dump written by writeBinary
   void read(istream & is);
-  //NOTE to clone object
-  //GroupPowerBigraph *clone();
+  // writes the graph as it was read, so that later runs can skip parsing
+  void writeBinary(ostream & os) const;
+  // rebuilds the subgraphs from the graph as it was last read, using the
+  // current thresholds and grouping flags. returns false when the graph
+  // has to be read again because the decoy peptide labeling changed
+  bool rethreshold();
 private:
 
+  void buildSubgraphs();
   void initialize();
   void getGroupProtNames();
+  void setApproximateSubgraphs();
   
   Array<BasicBigraph> iterativePartitionSubgraphs(BasicBigraph & bb, double newPeptideThreshold );
   
@@ -86,6 +113,10 @@ private:
   bool noprune;
   bool trivialgruping;
   bool multiple_labeled_peptides;
+  // the multiple_labeled_peptides the full graph was read with, -1 if it
+  // does not matter
+  int labeledFullGraph;
+  unsigned int gibbsSweeps;
   double ProteinThreshold;
   double PeptideThreshold;
   double PsmThreshold;
@@ -95,6 +126,8 @@ private:
   Array<double> probabilityR;
   Array<Array<std::string> > groupProtNames;
   Array<BasicGroupBigraph> subgraphs;
+  // the graph as read, before any pruning
+  BasicBigraph fullGraph;
 };
 
 ostream & operator <<(ostream & os, pair<double,double> rhs);
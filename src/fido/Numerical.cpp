@@ -2,6 +2,7 @@
 // see license for more information
 
 #include "Numerical.h"
+#include <algorithm>
 
 bool Numerical::isPos(double d)
 {
@@ -47,3 +48,40 @@ bool Numerical::isDifferentSign(double a, double b)
 {
   return isPos(a) && isNeg(b) || isNeg(a) && isPos(b);
 }
+
+void Numerical::exp2Batch(const double * x, double * result, int n)
+{
+  for (int k=0; k<n; k++)
+    result[k] = ::exp2(x[k]);
+}
+
+void Numerical::log2Batch(const double * x, double * result, int n)
+{
+  for (int k=0; k<n; k++)
+    result[k] = ::log2(x[k]);
+}
+
+double Numerical::logAddBatch(const double * x, int n)
+{
+  double largest = -inf();
+  int k;
+  for (k=0; k<n; k++)
+    largest = max(largest, x[k]);
+  if ( isinf(largest) )
+    return largest;
+
+  // exponentiate relative to the largest term, a block at a time
+  const int blockSize = 256;
+  double block[blockSize];
+  double sum = 0.0;
+  for (int start=0; start<n; start+=blockSize)
+    {
+      int size = min(blockSize, n-start);
+      for (k=0; k<size; k++)
+	block[k] = x[start+k] - largest;
+      exp2Batch(block, block, size);
+      for (k=0; k<size; k++)
+	sum += block[k];
+    }
+  return largest + ::log2(sum);
+}
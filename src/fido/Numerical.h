@@ -52,13 +52,28 @@ class Numerical
     {
       return logAdd(logB, logA);
     }
-    // assume logA <= logB
+    // assume logA >= logB
     // when one of the terms is very small, then just use the other term
-    if ( isinf(logA) && logA < 0 )
-      return logB;
+    if ( isinf(logB) && logB < 0 )
+      return logA;
 
-    return log2( 1 + pow(2, logB-logA) ) + logA;
+    // log1p keeps the precision when 2^(logB-logA) is tiny. M_LN2 is not
+    // defined everywhere, e.g. by MSVC without _USE_MATH_DEFINES
+    const double ln2 = 0.69314718055994530942;
+    return log1p( ::exp2(logB-logA) ) / ln2 + logA;
   }
+
+  // batched loops for the log2 space likelihoods over contiguous arrays.
+  // exp2Batch and log2Batch call the same libm functions as the scalar
+  // code, so every element is exactly what ::exp2 and ::log2 give.
+  // result may alias x
+  static void exp2Batch(const double * x, double * result, int n);
+  static void log2Batch(const double * x, double * result, int n);
+  // log2 of the sum of 2^x[k], -inf for an empty sum. The terms are
+  // summed relative to the largest one instead of folded with logAdd, so
+  // the result differs from the fold by rounding only: the absolute error
+  // is below about n * 2^-52
+  static double logAddBatch(const double * x, int n);
 };
 
 #endif
@@ -129,6 +129,11 @@ bool Fido::parseOptions(int argc, char** argv) {
       "Proteins with a very low score (< 0.001) will not be truncated (assigned 0.0 probability).(Only valid if option -A is active).",
       "",
       FALSE_IF_SET);
+  cmd.defineOption("D",
+      "dump-graph",
+      "Write the graph in a binary format to this file. The binary graph can be given instead of the graph file \
+       in later runs, which skips the parsing.",
+      "filename");
   
   
   // finally parse and handle return codes (display help etc...)
@@ -159,6 +164,7 @@ bool Fido::parseOptions(int argc, char** argv) {
   if (cmd.optionSet("b"))  fido_beta = cmd.getDouble("b", 0.00, 1.0);
   if (cmd.optionSet("G"))  fido_gamma = cmd.getDouble("G", 0.00, 1.0);
   if (cmd.optionSet("H"))  fido_mse_threshold = cmd.getDouble("H",0.001,1.0);
+  if (cmd.optionSet("D"))  dumpGraphFN = cmd.options["D"];
 
   fname = cmd.arguments[0];
 
@@ -184,10 +190,15 @@ int Fido::run() {
     cerr << protEstimator->printCopyright();
   }
   
-  ifstream fin(fname);
+  // binary mode, the graph file can also be a binary dump
+  ifstream fin(fname.c_str(), ios::in | ios::binary);
   
   protEstimator->run();
   protEstimator->computeProbabilitiesFromFile(fin);
+  if (!dumpGraphFN.empty())
+  {
+    protEstimator->writeGraph(dumpGraphFN);
+  }
   protEstimator->computeStatistics();
   
   time_t procStart;
@@ -81,6 +81,7 @@ class Fido {
 	std::string fname;
 	std::string targetOut;
 	std::string decoyOut;
+	std::string dumpGraphFN;
 	/*fido parameters*/
 	double fido_alpha;
 	double fido_beta;
@@ -353,7 +353,9 @@ startElement (const XMLCh* const uri,
               const XMLCh* const qname,
               const Attributes& attr)
 {
-  if ( depth_ == 0 || depth_ == 1 || ( depth_== 4 && XMLString::equals (qname, spectrumIdentificationResultStr) ))
+  if ( depth_ == 0 || depth_ == 1 || ( depth_== 4 && XMLString::equals (qname, spectrumIdentificationResultStr) )
+      || ( depth_ == 2 && ( XMLString::equals (qname, peptideStr) || XMLString::equals (qname, dBSequenceStr)
+                            || XMLString::equals (qname, peptideEvidenceStr) ) ))
   {
     doc_.reset (dom_impl_.createDocument (uri, qname, 0));
     cur_ = doc_->getDocumentElement ();
@@ -413,9 +415,10 @@ characters (const XMLCh* const s, const XMLSize_t length)
 {
   const XMLCh empty[] = {chNull};
 
-  // Ignore text content (presumably whitespaces) in the root element.
+  // Ignore text content (presumably whitespaces) in the root element and
+  // between the elements that have already been handed out.
   //
-  if (depth_ > 1)
+  if (depth_ > 1 && doc_.get () != 0)
   {
     DOMText* t = doc_->createTextNode (empty);
     static_cast<DOMTextImpl*> (t)->appendData (s, length);
@@ -428,7 +431,7 @@ characters (const XMLCh* const s, const unsigned int length)
 {
   // Ignore text content (presumably whitespaces) in the root element.
   //
-  if (depth_ > 1)
+  if (depth_ > 1 && doc_.get () != 0)
   {
     // For Xerces-C++ 2-series we have to make copy.
     //
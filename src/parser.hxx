@@ -19,6 +19,11 @@ using namespace xercesc;
 
 static const XMLCh spectrumIdentificationListStr[] = { chLatin_S, chLatin_p, chLatin_e, chLatin_c, chLatin_t,chLatin_r, chLatin_u, chLatin_m, chLatin_I, chLatin_d, chLatin_e, chLatin_n, chLatin_t, chLatin_i, chLatin_f, chLatin_i, chLatin_c, chLatin_a, chLatin_t, chLatin_i, chLatin_o, chLatin_n, chLatin_L, chLatin_i, chLatin_s, chLatin_t, chNull };
 static const XMLCh spectrumIdentificationResultStr[] = { chLatin_S, chLatin_p, chLatin_e, chLatin_c, chLatin_t,chLatin_r, chLatin_u, chLatin_m, chLatin_I, chLatin_d, chLatin_e, chLatin_n, chLatin_t, chLatin_i, chLatin_f, chLatin_i, chLatin_c, chLatin_a, chLatin_t, chLatin_i, chLatin_o, chLatin_n, chLatin_R, chLatin_e, chLatin_s, chLatin_u, chLatin_l, chLatin_t, chNull };
+// the entries of the mzIdentML SequenceCollection, they are handed out one by
+// one so that the reference tables can be built without a DOM of the section
+static const XMLCh peptideStr[] = { chLatin_P, chLatin_e, chLatin_p, chLatin_t, chLatin_i, chLatin_d, chLatin_e, chNull };
+static const XMLCh dBSequenceStr[] = { chLatin_D, chLatin_B, chLatin_S, chLatin_e, chLatin_q, chLatin_u, chLatin_e, chLatin_n, chLatin_c, chLatin_e, chNull };
+static const XMLCh peptideEvidenceStr[] = { chLatin_P, chLatin_e, chLatin_p, chLatin_t, chLatin_i, chLatin_d, chLatin_e, chLatin_E, chLatin_v, chLatin_i, chLatin_d, chLatin_e, chLatin_n, chLatin_c, chLatin_e, chNull };
 
 
 
@@ -24,6 +24,10 @@ using namespace std;
 // for compatibility issues, not using log2
 
 AlgIn::AlgIn(const int size, const int numFeat) {
+  // account before allocating, so that nothing leaks if the memory limit
+  // is exceeded and allocateMemory throws
+  memoryUsage = size * (sizeof(const double*) + 2 * sizeof(double));
+  Globals::getInstance()->getProfiler()->allocateMemory("AlgIn", memoryUsage);
   vals = new const double*[size];
   Y = new double[size];
   C = new double[size];
@@ -35,6 +39,7 @@ AlgIn::~AlgIn() {
   delete[] vals;
   delete[] Y;
   delete[] C;
+  Globals::getInstance()->getProfiler()->releaseMemory("AlgIn", memoryUsage);
 }
 
 int CGLS(const AlgIn& data, const double lambda, const int cgitermax,
@@ -41,6 +41,8 @@ class AlgIn {
         C[ix] = pos;
       }
     }
+  private:
+    size_t memoryUsage;
 };
 
 /* Data: Input examples are stored in sparse (Compressed Row Storage) format */